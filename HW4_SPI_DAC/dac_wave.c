@@ -0,0 +1,218 @@
+// dac_wave.c
+// DMA waveform engine for the MCP4912, see dac_wave.h
+#include <math.h>
+#include "dac_wave.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+
+static uint16_t tables[2][2 * DAC_TABLE_MAX]; // A, B, A, B, ...
+static int table_len[2];
+static volatile const uint16_t *next_table;   // what the control channel loads at the end of a table
+static int pending = -1;                       // table waiting to start, -1 if none
+
+static spi_inst_t *dac_spi;
+static int data_chan = -1, ctrl_chan = -1, pace_timer = -1;
+static float rate_hz;
+static float actual_hz[2];
+
+uint16_t dac_wave_command(int channel, float voltage) {
+    // here we clamp the voltage between 0 and VREF
+    if (voltage < 0) voltage = 0;
+    if (voltage > DAC_VREF) voltage = DAC_VREF;
+    uint16_t code = (uint16_t)((voltage / DAC_VREF) * 4095.0f); // 12 bit code, the MCP4912 keeps the top 10
+
+    uint16_t command = 0;
+    command |= (channel & 0x01) << 15; // bit 15: DACB/A selection (1 = B, 0 = A)
+    command |= (1 << 14);              // bit 14: BUF (1 = buffered)
+    command |= (1 << 13);              // bit 13: Gain (1 = 1x)
+    command |= (1 << 12);              // bit 12: SHDN (1 = active mode)
+    command |= (code & 0x0FFF);        // bits 11-0: DAC input value
+    return command;
+}
+
+const char *dac_wave_shape_name(wave_shape_t shape) {
+    static const char *names[] = {"dc", "sine", "triangle", "square", "saw"};
+    return shape < WAVE_SHAPES ? names[shape] : "?";
+}
+
+// closest numerator/denominator for the pacing timer, rate = clk_sys * x / y with both 16 bits
+static float set_timer(float words_per_s) {
+    float clk = (float)clock_get_hz(clk_sys);
+    float r = words_per_s / clk;
+    uint32_t best_x = 1, best_y = 65535, y;
+    float best_err = 1e30f;
+    for (y = 1; y <= 65535; y++) {
+        uint32_t x = (uint32_t)(r * y + 0.5f);
+        if (x < 1 || x > y) continue; // can't go above clk_sys either
+        float err = fabsf((float)x / y - r);
+        if (err < best_err) {
+            best_err = err;
+            best_x = x;
+            best_y = y;
+        }
+    }
+    dma_timer_set_fraction(pace_timer, (uint16_t)best_x, (uint16_t)best_y);
+    return clk * best_x / best_y;
+}
+
+bool dac_wave_init(spi_inst_t *spi, uint sck, uint mosi, uint cs, uint baud, float sample_rate) {
+    dac_spi = spi;
+    uint actual_baud = spi_init(spi, baud);
+    float clk = (float)clock_get_hz(clk_sys);
+    float words = 2 * sample_rate;
+    if (words * DAC_CLOCKS_PER_WORD > actual_baud || words < clk / 65535) {
+        return false;
+    }
+    // mode 0,0 with 16 bit frames, the PL022 pulses CSn high after every frame in this mode
+    spi_set_format(spi, 16, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
+    gpio_set_function(sck, GPIO_FUNC_SPI);
+    gpio_set_function(mosi, GPIO_FUNC_SPI);
+    gpio_set_function(cs, GPIO_FUNC_SPI);
+
+    if (data_chan < 0) {
+        data_chan = dma_claim_unused_channel(true);
+        ctrl_chan = dma_claim_unused_channel(true);
+        pace_timer = dma_claim_unused_timer(true);
+    } else {
+        dma_channel_abort(data_chan);
+        dma_channel_abort(ctrl_chan);
+    }
+    rate_hz = set_timer(words) / 2;
+
+    // data: a word per timer tick into the SPI, then hand over to the control channel
+    dma_channel_config c = dma_channel_get_default_config(data_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, dma_get_timer_dreq(pace_timer));
+    channel_config_set_chain_to(&c, ctrl_chan);
+    dma_channel_configure(data_chan, &c, &spi_get_hw(spi)->dr, NULL, 0, false);
+
+    // control: copy next_table into the data channel's read address, the trigger alias starts it.
+    // The transfer count isn't touched, the data channel reloads the last one written every start
+    c = dma_channel_get_default_config(ctrl_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(ctrl_chan, &c, &dma_channel_hw_addr(data_chan)->al3_read_addr_trig, &next_table, 1, false);
+
+    // mid scale on both until the first dac_wave_set()
+    int i;
+    for (i = 0; i < 2; i++) {
+        tables[0][i] = dac_wave_command(i, DAC_VREF / 2);
+    }
+    table_len[0] = 1;
+    actual_hz[0] = actual_hz[1] = 0;
+    pending = -1;
+    next_table = tables[0];
+    dma_channel_set_trans_count(data_chan, 2, false);
+    dma_channel_set_read_addr(data_chan, tables[0], true);
+    return true;
+}
+
+// the table the data channel is reading from now
+static int playing() {
+    uintptr_t addr = dma_channel_hw_addr(data_chan)->read_addr;
+    return (addr >= (uintptr_t)tables[1] && addr <= (uintptr_t)&tables[1][2 * DAC_TABLE_MAX]) ? 1 : 0;
+}
+
+// cycles in n samples, the rounded frequency stays under Nyquist
+static int whole_cycles(float frequency, int n) {
+    if (frequency <= 0) return 0;
+    int cycles = (int)lroundf(frequency * n / rate_hz);
+    if (cycles < 1) cycles = 1;
+    return cycles;
+}
+
+// the table length where both frequencies round least, the shortest of those so changes start sooner
+static int pick_length(float fa, float fb) {
+    int best_n = DAC_TABLE_MAX, n;
+    float best_err = 1e30f;
+    for (n = 2; n <= DAC_TABLE_MAX; n++) {
+        float err = 0;
+        if (fa > 0) err += fabsf(whole_cycles(fa, n) * rate_hz / n - fa) / fa;
+        if (fb > 0) err += fabsf(whole_cycles(fb, n) * rate_hz / n - fb) / fb;
+        if (err < best_err) {
+            best_err = err;
+            best_n = n;
+        }
+    }
+    return best_n;
+}
+
+// one cycle goes from phase 0 to 1, shapes run from -1 to 1
+static float shape_value(wave_shape_t shape, float phase) {
+    switch (shape) {
+        case WAVE_SINE:     return sinf(2 * (float)M_PI * phase);
+        case WAVE_TRIANGLE: return phase < 0.5f ? 4 * phase - 1 : 3 - 4 * phase;
+        case WAVE_SQUARE:   return phase < 0.5f ? 1 : -1;
+        case WAVE_SAW:      return 2 * phase - 1;
+        default:            return 0;
+    }
+}
+
+bool dac_wave_fits(const wave_t *w) {
+    return w->shape == WAVE_DC || (w->frequency * 2 <= rate_hz && w->frequency * DAC_TABLE_MAX >= rate_hz);
+}
+
+bool dac_wave_busy() {
+    return pending >= 0 && playing() != pending;
+}
+
+bool dac_wave_set(const wave_t *a, const wave_t *b) {
+    const wave_t *w[2] = {a, b};
+    int ch;
+    if (!dac_wave_fits(a) || !dac_wave_fits(b)) {
+        return false;
+    }
+    if (dac_wave_busy()) {
+        return false; // the last change hasn't started yet, its table isn't free
+    }
+    pending = -1;
+
+    int t = 1 - playing();
+    int n = pick_length(a->shape == WAVE_DC ? 0 : a->frequency, b->shape == WAVE_DC ? 0 : b->frequency);
+    for (ch = 0; ch < 2; ch++) {
+        int cycles = w[ch]->shape == WAVE_DC ? 0 : whole_cycles(w[ch]->frequency, n);
+        actual_hz[ch] = cycles * rate_hz / n;
+        int i;
+        for (i = 0; i < n; i++) {
+            float phase = (float)((long)i * cycles % n) / n; // exact, so the last sample joins the first
+            tables[t][2*i + ch] = dac_wave_command(ch, w[ch]->offset + w[ch]->amplitude * shape_value(w[ch]->shape, phase));
+        }
+    }
+    table_len[t] = n;
+
+    // the count and the address have to go in between the same two table ends. Writing the count
+    // only sets its reload value, so both are written right after a word went out, which leaves
+    // a whole word time (36 clocks at least) before anything else happens, unless that word was
+    // the last one and the control channel is already loading the next table
+    volatile uint32_t *count = &dma_channel_hw_addr(data_chan)->transfer_count;
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t seen = *count, now;
+    do {
+        while ((now = *count) == seen) {
+            tight_loop_contents();
+        }
+        seen = now;
+    } while (now == 0);
+    *count = 2 * n;
+    next_table = tables[t];
+    restore_interrupts(save);
+    pending = t;
+    return true;
+}
+
+float dac_wave_sample_rate() {
+    return rate_hz;
+}
+
+float dac_wave_frequency(int channel) {
+    return actual_hz[channel & 1];
+}
+
+int dac_wave_table_length() {
+    return table_len[pending >= 0 ? pending : playing()];
+}
@@ -0,0 +1,71 @@
+// dac_wave.h
+// Two channel waveform output on the MCP4912 without the CPU. A table of ready made 16 bit
+// command words, channel A and B taking turns, is streamed to the SPI data register by DMA,
+// one word each tick of a DMA pacing timer. The SPI runs 16 bit frames with the hardware chip
+// select, which goes high between frames, so every word is one complete DAC write.
+//
+// A second DMA channel is chained to the first and points it back at the start of the table
+// when it finishes, so the table repeats forever. Changes are built into the other of two
+// tables and the control channel picks that one up at the end of the table playing now, so a
+// waveform is never cut short and never shows half old, half new.
+//
+// Every channel plays a whole number of cycles per table so the end joins the start without a
+// step, which rounds the frequencies a little. The table length is picked to make that as small
+// as possible for both channels, dac_wave_frequency() says what you got. The slowest wave is
+// one cycle in DAC_TABLE_MAX samples, so lower the sample rate for slow waves.
+//
+//   dac_wave_init(spi0, PIN_SCK, PIN_MOSI, PIN_CS, 10*1000*1000, 2000); // 2 kHz per channel
+//   wave_t sine = {WAVE_SINE, 2.0f, 1.65f, 1.65f}, tri = {WAVE_TRIANGLE, 1.0f, 1.65f, 1.65f};
+//   dac_wave_set(&sine, &tri);
+//
+// A change waits for the end of the table playing now, up to DAC_TABLE_MAX samples (2 s at
+// 2 kHz, 3.4 s at the slowest rate). dac_wave_set() doesn't wait for it: while one change is
+// still pending it returns false and the caller keeps its waves and tries again later
+// (dac_wave_busy()).
+#ifndef DAC_WAVE_H
+#define DAC_WAVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/spi.h"
+
+#define DAC_VREF 3.3f
+#define DAC_TABLE_MAX 4096      // samples per channel, two tables of 2 words a sample is 32 KB
+#define DAC_CLOCKS_PER_WORD 18  // 16 bits and the chip select gap between frames, the SPI's limit
+
+typedef enum {
+    WAVE_DC,       // offset only
+    WAVE_SINE,
+    WAVE_TRIANGLE,
+    WAVE_SQUARE,
+    WAVE_SAW,
+    WAVE_SHAPES
+} wave_shape_t;
+
+typedef struct {
+    wave_shape_t shape;
+    float frequency; // Hz
+    float amplitude; // V, peak
+    float offset;    // V, the middle of the wave. Clipped to 0 to DAC_VREF
+} wave_t;
+
+// cs has to be the SPI's CSn pin. false if the rate is more than the SPI can send at that baud,
+// or less than the pacing timer can count down to (about 1.2 kHz per channel at 150 MHz)
+bool dac_wave_init(spi_inst_t *spi, uint sck, uint mosi, uint cs, uint baud, float sample_rate);
+
+// plays a and b from the end of the current table on. false, and nothing changes, if
+// dac_wave_busy() or a wave doesn't dac_wave_fits(). Never waits on the table, only spins with
+// interrupts off for the next word to go out, at most two word times (under 1 ms at the slowest rate)
+bool dac_wave_set(const wave_t *a, const wave_t *b);
+// the last dac_wave_set() hasn't started playing yet, up to one table: table length / sample rate
+bool dac_wave_busy(void);
+// false if the frequency is over half the sample rate, or so low a cycle doesn't fit in DAC_TABLE_MAX samples
+bool dac_wave_fits(const wave_t *w);
+
+float dac_wave_sample_rate(void);      // per channel, after the timer rounded it
+float dac_wave_frequency(int channel); // what the whole cycles per table came out at
+int dac_wave_table_length(void);       // samples per channel
+uint16_t dac_wave_command(int channel, float voltage); // one MCP4912 write
+const char *dac_wave_shape_name(wave_shape_t shape);
+
+#endif
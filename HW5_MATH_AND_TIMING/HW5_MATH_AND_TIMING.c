@@ -5,6 +5,7 @@
 #include "hardware/spi.h"
 #include <math.h>
 #include <stdint.h>
+#include "scheduler.h"
 
 // SPI defines for the DAC
 #define SPI_PORT spi0
@@ -244,8 +245,12 @@ int main() {
     }
 
     // here is our main loop for the math timing.
+    // one DAC sample per millisecond off a hardware alarm, send 's' over USB for the timing
     int index = 0;
+    scheduler_t sched;
+    scheduler_init(&sched, 1000);
     while (true) {
+        scheduler_wait(&sched);
         if (gpio_get(BUTTON_PIN) == 0) {
             sleep_ms(20);
             if (gpio_get(BUTTON_PIN) == 0) {
@@ -259,8 +264,8 @@ int main() {
         // reading float from the ram and then write it to the dac
         float v = read_float_from_ram(index * 4);
         writeDac(0, v);
-        sleep_ms(1);
         index = (index + 1) % 1000;
+        scheduler_poll_usb(&sched, "dac");
     }
 
     return 0;
@@ -2,7 +2,7 @@
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "ssd1306.h"
-#include "font.h"
+#include "ssd1306_widget.h"
 #include "hardware/adc.h"
 
 // I2C defines
@@ -13,8 +13,6 @@
 #define I2C_SCL 9
 
 
-void drawmytext(int x, int y, char *m);
-void drawLetter(int x, int y, char c);
 void pixelBlink(int x, int y);
 void display_voltage(float voltage);
 // have 128 pixels in a row, 32 pixels in a column
@@ -48,6 +46,10 @@ int main()
 
     ssd1306_setup();
     ssd1306_clear();
+    ssd1306_draw_string(2, 2, "Damian Gonzalez's"); // 2,2 is the x,y position of the text
+    ssd1306_draw_string(2, 12, "HW7 I2C OLED"); // this line is 10 pixels below the previous line
+    ssd1306_field_t voltage_field; // only the digits that change get redrawn
+    ssd1306_field_init(&voltage_field, 2, 22, "Voltage: ", 4, 2, "V"); // this line is 10 pixels below the previous line
     ssd1306_update();
 
     while (true) {
@@ -55,14 +57,8 @@ int main()
         uint16_t adc_value = adc_read();
         float voltage = (adc_value * 3.3f) / 4095.0f;
 
-        // Draw to OLED
-        ssd1306_clear(); // clear ONCE at the start
-        drawmytext(2, 2, "Damian Gonzalez's"); // 2,2 is the x,y position of the text
-        drawmytext(2, 12, "HW7 I2C OLED"); // this line is 10 pixels below the previous line
-        
-        char vbuf[30];
-        sprintf(vbuf, "Voltage: %.2fV", voltage);
-        drawmytext(2, 22, vbuf); // this line is 10 pixels below the previous line
+        // Draw to OLED, voltage in hundredths of a volt so it formats without floats
+        ssd1306_field_set(&voltage_field, (adc_value * 330 + 2047) / 4095);
 
         ssd1306_update(); // update AFTER all drawings
 
@@ -81,42 +77,6 @@ int main()
     }
 }
 
-void drawmytext(int x, int y, char *m) {
-    int i = 0; // index of the character in the string
-    int startX = x; // save the initial x position
-    while (m[i] != '\0') { // loop through every character in the string
-        if (x + 5 >= 128) {
-            x = startX;      // Reset to initial x
-            y += 8;          // Move to next row (each char is 8 pixels tall)
-            if (y + 8 > 32) break; // Don't draw below the screen
-        }
-        drawLetter(x, y, m[i]);
-        x += 6; // Move to next character (5 pixels + 1 spacing)
-        i++;
-    }
-}
-
-
-
-void drawLetter(int x, int y, char c) {
-    int index = c - 0x20;
-    // index is the index of the character in the ASCII array
-    // 0x20 is the ASCII value of the space character, so we subtract it to get the index of the character in the ASCII array
-    if (index < 0 || index >= 96) return; // skip unprintables
-    // 96 is the number of characters in the ASCII array
-
-    for (int i = 0; i < 5; i++) { // loop through the columns of the character
-        // 5 is the width of the character in pixels
-        char col = ASCII[index][i];
-        for (int j = 0; j < 8; j++) { // loop through the rows of the character
-            // 8 is the height of the character in pixels
-            // we need to shift the column to the right by j bits and mask it with 0b1 to get the value of the pixel
-            char on = (col >> j) & 0b1;
-            ssd1306_drawPixel(x + i, y + j, on);
-        }
-    }
-}
-
 void pixelBlink(int x, int y) {
     ssd1306_drawPixel(x, y, 1); // set the pixel to 1 (white)
     ssd1306_update(); // update the screen
@@ -129,6 +89,6 @@ void display_voltage(float voltage) {
     char buffer[20];
     sprintf(buffer, "Voltage: %.2fV", voltage);
     ssd1306_clear();
-    drawmytext(0, 0, buffer);
+    ssd1306_draw_string(0, 0, buffer);
     ssd1306_update();
 }
\ No newline at end of file
@@ -1,41 +1,33 @@
 #include <stdio.h>
+#include <inttypes.h> // PRIu32/PRIu64, the same on the pico and in a host build
 #include "pico/stdlib.h"
 #include "ssd1306.h"
+#include "scheduler.h"
+#include "mpu6050.h"
+#include "imu_stream.h"
+#include "attitude.h"
 #include "hardware/i2c.h"
-#include "math.h"
-#include "font.h"
-
-// config registers
-#define CONFIG 0x1A
-#define GYRO_CONFIG 0x1B
-#define ACCEL_CONFIG 0x1C
-#define PWR_MGMT_1 0x6B
-#define PWR_MGMT_2 0x6C
-// sensor data registers:
-#define ACCEL_XOUT_H 0x3B
-#define ACCEL_XOUT_L 0x3C
-#define ACCEL_YOUT_H 0x3D
-#define ACCEL_YOUT_L 0x3E
-#define ACCEL_ZOUT_H 0x3F
-#define ACCEL_ZOUT_L 0x40
-#define TEMP_OUT_H   0x41
-#define TEMP_OUT_L   0x42
-#define GYRO_XOUT_H  0x43
-#define GYRO_XOUT_L  0x44
-#define GYRO_YOUT_H  0x45
-#define GYRO_YOUT_L  0x46
-#define GYRO_ZOUT_H  0x47
-#define GYRO_ZOUT_L  0x48
-#define WHO_AM_I     0x75
-
-// I2C address of the MPU6050
+
+// the MPU6050 and the OLED share this bus
 #define I2C_PORT i2c0
+#define I2C_BAUD (400 * 1000)
 #define SDA_PIN1 8
 #define SCL_PIN1 9
 #define SDA_PIN2 21
 #define SCL_PIN2 22
 
-#define MPU6050_ADDRESS 0x68
+// streaming mode: the MPU6050 samples at IMU_RATE_HZ into its FIFO and pulses INT on this pin,
+// the loop drains it in batches at the display rate (see imu_stream.h). 0 goes back to one
+// burst read per loop
+#define IMU_STREAMING 1
+#define IMU_INT_PIN 10
+#define IMU_RATE_HZ 1000
+#define DISPLAY_PERIOD_US 33333 // 30 Hz
+
+// roll and pitch from every sample (attitude.h). Hold the board still for the first half second
+// while the gyro bias is measured. Send 'l' over USB to log every raw sample as CSV for
+// host/imu_tool --replay, 'l' again to stop
+#define ATTITUDE_TIME_CONSTANT 0.5f // seconds, how slowly the accel corrects the gyro
 
 // Led pin
 #define LED_BUILTIN 25
@@ -47,28 +39,6 @@
 
 
 
-// to turn on the chip write 0x00 to PWR_MGMT_1 register to turn on the chip
-// to turn off the chip write 0x40 to PWR_MGMT_1 register to turn off the chip
-
-// to enable the accelerometer write to the ACCEL_CONFIG register.
-// Set the sensitivity to 2g by writing 0x00 to the ACCEL_CONFIG register.
-
-// to enable the gyroscope write to the GYRO_CONFIG register.
-// Set the sensitivity to 2000 dps by writing 0x18 to the GYRO_CONFIG register.
-
-void i2c_write(uint8_t address, uint8_t reg, uint8_t value);
-
-// initialize the mpu6050
-void initialize_MPU6050()
-{
-    // Set the PWR_MGMT_1 register to 0x00 to wake up the MPU6050
-    i2c_write(MPU6050_ADDRESS, PWR_MGMT_1, 0x00);
-    // Set the ACCEL_CONFIG register to 0x00 to set the accelerometer sensitivity to 2g
-    i2c_write(MPU6050_ADDRESS, ACCEL_CONFIG, 0x00);
-    // Set the GYRO_CONFIG register to 0x18 to set the gyroscope sensitivity to 2000 dps
-    i2c_write(MPU6050_ADDRESS, GYRO_CONFIG, 0x18);
-}
-
 // initialize the pins
 void initialize_pins()
 {
@@ -78,7 +48,7 @@ void initialize_pins()
     gpio_put(LED_BUILTIN, 0); // turn off the LED
 
     // Initialize I2C
-    i2c_init(I2C_PORT, 400 * 1000); // 400kHz
+    i2c_init(I2C_PORT, I2C_BAUD); // 400kHz
     gpio_set_function(SDA_PIN1, GPIO_FUNC_I2C);
     gpio_set_function(SCL_PIN1, GPIO_FUNC_I2C);
     gpio_pull_up(SDA_PIN1);
@@ -90,22 +60,6 @@ void initialize_pins()
     gpio_pull_up(SCL_PIN2);
 }
 
-// ==== I2C Helper Functions ====
-
-// here we write to our pin
-void i2c_write(uint8_t address, uint8_t reg, uint8_t value) {
-    uint8_t buf[] = {reg, value};
-    i2c_write_blocking(I2C_PORT, address, buf, 2, false);
-}
-
-// here we read our pin input
-uint8_t i2c_read(uint8_t address, uint8_t reg) {
-    i2c_write_blocking(I2C_PORT, address, &reg, 1, true);
-    uint8_t value;
-    i2c_read_blocking(I2C_PORT, address, &value, 1, false);
-    return value;
-}
-
 // error loop 
 void error_loop() {
     gpio_put(LED_BUILTIN, 1); // turn on the LED
@@ -114,6 +68,21 @@ void error_loop() {
     }
 }
 
+// what one burst costs on the bus, worked out and timed, before the OLED starts using it too
+void report_sample_rate() {
+    const int n = 100;
+    mpu6050_raw_t raw;
+    int i;
+    uint64_t start = time_us_64();
+    for (i = 0; i < n; i++) {
+        mpu6050_read(&raw);
+    }
+    float measured_us = (float)(time_us_64() - start) / n;
+    float bus_us = mpu6050_burst_us(I2C_BAUD);
+    printf("burst read: %.0f us on the wire, %.0f us measured, at most %.0f samples/s at %d kHz\n",
+           bus_us, measured_us, 1e6f / measured_us, I2C_BAUD / 1000);
+}
+
 // ====OLED Functions====
 
 void draw_arrow(float accel_x, float accel_y) {
@@ -125,59 +94,8 @@ void draw_arrow(float accel_x, float accel_y) {
     int x1 = x0 + accel_x;
     int y1 = y0 - accel_y; // Invert Y-axis
 
-    // Draw main arrow line
-    ssd1306_draw_line(x0, y0, x1, y1, 1);
-
-    // ==== Arrowhead ====
-    float angle = atan2(y1 - y0, x1 - x0); // Angle of the arrow
-    float arrow_length = 5.0;              // Length of each side of the arrowhead
-    float arrow_angle = M_PI / 6;          // 30 degrees
-
-    // Points for left side of arrowhead
-    int x2 = x1 - (int)(arrow_length * cos(angle - arrow_angle));
-    int y2 = y1 - (int)(arrow_length * sin(angle - arrow_angle));
-
-    // Points for right side of arrowhead
-    int x3 = x1 - (int)(arrow_length * cos(angle + arrow_angle));
-    int y3 = y1 - (int)(arrow_length * sin(angle + arrow_angle));
-
-    // Draw the two arrowhead lines
-    ssd1306_draw_line(x1, y1, x2, y2, 1);
-    ssd1306_draw_line(x1, y1, x3, y3, 1);
-}
-
-void drawLetter(int x, int y, char c) {
-    int index = c - 0x20; // 0x20 is the ASCII value of the space character
-    // index is the index of the character in the ASCII array
-    // 0x20 is the ASCII value of the space character, so we subtract it to get the index of the character in the ASCII array
-    if (index < 0 || index >= 96) return; // skip unprintables
-    // 96 is the number of characters in the ASCII array
-
-    for (int i = 0; i < 5; i++) { // loop through the columns of the character
-        // 5 is the width of the character in pixels
-        char col = ASCII[index][i];
-        for (int j = 0; j < 8; j++) { // loop through the rows of the character
-            // 8 is the height of the character in pixels
-            // we need to shift the column to the right by j bits and mask it with 0b1 to get the value of the pixel
-            char on = (col >> j) & 0b1;
-            ssd1306_drawPixel(x + i, y + j, on);
-        }
-    }
-}
-
-void drawmytext(int x, int y, char *m) {
-    int i = 0; // index of the character in the string
-    int startX = x; // save the initial x position
-    while (m[i] != '\0') { // loop through every character in the string
-        if (x + 5 >= 128) {
-            x = startX;      // Reset to initial x
-            y += 8;          // Move to next row (each char is 8 pixels tall)
-            if (y + 8 > 32) break; // Don't draw below the screen
-        }
-        drawLetter(x, y, m[i]);
-        x += 6; // Move to next character (5 pixels + 1 spacing)
-        i++;
-    }
+    // shaft and a 5 pixel arrowhead, integer math in the library (no atan2/cos/sin in double)
+    ssd1306_draw_arrow(x0, y0, x1, y1, 5, 1);
 }
 
 int main()
@@ -188,34 +106,109 @@ int main()
     ssd1306_setup(); // Initialize the OLED display
     ssd1306_clear();
     ssd1306_update();
-    uint8_t who_am_i = i2c_read(MPU6050_ADDRESS, WHO_AM_I);
-    printf("WHO_AM_I: 0x%02X\n", who_am_i);
-    if (who_am_i != 0x68 && who_am_i != 0x98) {
+    mpu6050_set_port(i2c_hw_index(I2C_PORT), MPU6050_ADDRESS);
+    mpu6050_set_bus_wait(ssd1306_wait); // the OLED shares the bus, let its flush finish
+    if (!mpu6050_setup(MPU6050_ACCEL_2G, MPU6050_GYRO_2000DPS)) {
+        printf("WHO_AM_I: 0x%02X\n", mpu6050_who_am_i());
         printf("Error: MPU6050 not found\n");
         error_loop();
     }
     printf("MPU6050 found\n");
-    initialize_MPU6050();
+    report_sample_rate();
 
     printf("Reading sensor data...\n");
+    scheduler_t sched;
+    unsigned int rate = 50;
+    if (IMU_STREAMING) {
+        rate = imu_stream_start(IMU_INT_PIN, IMU_RATE_HZ);
+        printf("streaming at %u Hz, INT on GPIO %d\n", rate, IMU_INT_PIN);
+        scheduler_init(&sched, DISPLAY_PERIOD_US); // send 's' over USB for the loop timing
+    } else {
+        scheduler_init(&sched, 1000000 / rate);
+    }
+    attitude_t att;
+    attitude_init(&att, mpu6050_gyro_lsb_per_dps(), mpu6050_accel_lsb_per_g(), rate, ATTITUDE_TIME_CONSTANT);
+    bool logging = false;
+    uint32_t filter_us = 0, filter_max_us = 0;
+    mpu6050_raw_t raw = {0}; // newest sample, stays on the screen through a frame with none
     while (1) {
-        // Read raw accel values
-        int16_t accel_x = (i2c_read(MPU6050_ADDRESS, ACCEL_XOUT_H) << 8) | i2c_read(MPU6050_ADDRESS, ACCEL_XOUT_L);
-        int16_t accel_y = (i2c_read(MPU6050_ADDRESS, ACCEL_YOUT_H) << 8) | i2c_read(MPU6050_ADDRESS, ACCEL_YOUT_L);
-
-        // Scale to g
-        float fx = (float)accel_x * 0.000061f;
-        float fy = (float)accel_y * 0.000061f;
-
-        printf("Accel X: %.2f g, Y: %.2f g\n", fx, fy);
+        scheduler_wait(&sched);
+        mpu6050_sample_t imu;
+        int n = 1;
+        uint64_t first_us = 0, last_us = time_us_64();
+        uint64_t filter_start = 0;
+        if (IMU_STREAMING) {
+            // everything the chip sampled since the last frame goes through the filter, the newest one goes on the screen
+            n = imu_stream_poll();
+            imu_sample_t sample;
+            int i = 0;
+            filter_start = time_us_64();
+            while (imu_stream_get(&sample)) {
+                if (i++ == 0) first_us = sample.time_us;
+                last_us = sample.time_us;
+                raw = sample.raw;
+                if (!att.calibrated) {
+                    attitude_calibrate(&att, &raw);
+                } else {
+                    attitude_update(&att, &raw);
+                }
+                if (logging) { // the raw counts, imu_tool --replay reads these back
+                    printf("%" PRIu64 ",%d,%d,%d,%d,%d,%d,%d\n", sample.time_us, raw.accel[0], raw.accel[1], raw.accel[2],
+                           raw.temp, raw.gyro[0], raw.gyro[1], raw.gyro[2]);
+                }
+            }
+        } else if (!mpu6050_read(&raw)) { // all seven channels in one burst
+            printf("MPU6050 read failed\n");
+            continue;
+        } else {
+            filter_start = time_us_64();
+            if (!att.calibrated) {
+                attitude_calibrate(&att, &raw);
+            } else {
+                attitude_update(&att, &raw);
+            }
+        }
+        if (n > 0) { // no new samples, nothing was filtered but the screen and USB still get their turn
+            filter_us = (uint32_t)(time_us_64() - filter_start); // includes the log printf when logging
+            if (filter_us > filter_max_us) filter_max_us = filter_us;
+        }
+        mpu6050_scale(&raw, &imu);
+        float fx = imu.accel[0];
+        float fy = imu.accel[1];
+
+        if (!logging && n > 0) {
+            if (IMU_STREAMING) {
+                printf("%d samples over %" PRIu64 " us, %" PRIu32 " interrupts, %" PRIu32 " overflows, %" PRIu32 " dropped\n", n,
+                       last_us - first_us, imu_stream_interrupts(), imu_stream_overflows(), imu_stream_dropped());
+            }
+            printf("Accel X: %.2f g, Y: %.2f g, Z: %.2f g\n", imu.accel[0], imu.accel[1], imu.accel[2]);
+            printf("Gyro X: %.1f, Y: %.1f, Z: %.1f dps, Temp: %.1f C\n", imu.gyro[0], imu.gyro[1], imu.gyro[2], imu.temp);
+            if (att.calibrated) {
+                printf("Roll: %.1f, Pitch: %.1f deg, Yaw rate: %.1f dps, filter %" PRIu32 " us for %d samples (max %" PRIu32 " us)\n",
+                       attitude_degrees(att.roll), attitude_degrees(att.pitch), attitude_rate_dps(&att, 2, mpu6050_gyro_lsb_per_dps()),
+                       filter_us, n, filter_max_us);
+            } else {
+                printf("Hold still, measuring the gyro bias\n");
+            }
+        }
 
         // Draw on OLED
         ssd1306_clear();
         draw_arrow(C * fx, C * fy);
-        drawmytext(2, 2, "Acceleration Arrow");
+        ssd1306_draw_string(2, 2, "Acceleration Arrow");
         ssd1306_update();
-
-        sleep_ms(20);
+        if (!logging) {
+            printf("OLED: %u bytes\n", ssd1306_bytes_sent()); // only the columns the arrow moved through
+        }
+        int c = getchar_timeout_us(0);
+        if (c == 'l' && IMU_STREAMING) {
+            logging = !logging;
+            if (logging) {
+                printf("time_us,ax,ay,az,temp,gx,gy,gz\n");
+            }
+        } else {
+            scheduler_command(&sched, "imu", c);
+        }
     }
 return 0;
 }
@@ -0,0 +1,171 @@
+// attitude.c
+// fixed point complementary filter, see attitude.h
+#include <stddef.h>
+#include <math.h>
+#include "attitude.h"
+
+#define CORDIC_STEPS 16
+#define CORDIC_INV_GAIN_Q30 652032874 // 1 / 1.64676, what 16 steps stretch a vector by
+#define CORDIC_GAIN_Q14 26981
+#define ACCEL_SCALE 256               // accel counts go into the CORDIC as Q8
+
+// atan(2^-i) as binary angles
+static const int32_t cordic_atan[CORDIC_STEPS] = {
+    536870912, 316933406, 167458907, 85004756, 42667331, 21354465, 10679838, 5340245,
+    2670163, 1335087, 667544, 333772, 166886, 83443, 41722, 20861,
+};
+
+// turn (x, y) onto the x axis, the angle it took is atan2(y, x)
+angle_t attitude_atan2(int32_t y, int32_t x, int32_t *magnitude) {
+    uint32_t angle = 0;
+    if (x < 0) { // CORDIC only covers +-99 degrees, start from the other side
+        x = -x;
+        y = -y;
+        angle = 0x80000000u;
+    }
+    int i;
+    for (i = 0; i < CORDIC_STEPS; i++) {
+        int32_t xi = x >> i, yi = y >> i;
+        if (y > 0) {
+            x += yi;
+            y -= xi;
+            angle += cordic_atan[i];
+        } else {
+            x -= yi;
+            y += xi;
+            angle -= cordic_atan[i];
+        }
+    }
+    if (magnitude) {
+        *magnitude = x;
+    }
+    return (angle_t)angle;
+}
+
+// turn (1/gain, 0) by the angle, it comes out as (cos, sin)
+void attitude_sincos(angle_t angle, int32_t *sine, int32_t *cosine) {
+    int32_t x = CORDIC_INV_GAIN_Q30, y = 0;
+    int32_t z = angle;
+    bool flip = false;
+    if (z > ANGLE_QUARTER_TURN || z < -ANGLE_QUARTER_TURN) {
+        z = (int32_t)((uint32_t)z + 0x80000000u); // the other half, sin and cos change sign
+        flip = true;
+    }
+    int i;
+    for (i = 0; i < CORDIC_STEPS; i++) {
+        int32_t xi = x >> i, yi = y >> i;
+        if (z >= 0) {
+            x -= yi;
+            y += xi;
+            z -= cordic_atan[i];
+        } else {
+            x += yi;
+            y -= xi;
+            z += cordic_atan[i];
+        }
+    }
+    *sine = flip ? -y : y;
+    *cosine = flip ? -x : x;
+}
+
+void attitude_init(attitude_t *a, float gyro_lsb_per_dps, float accel_lsb_per_g, unsigned int rate_hz, float time_constant_s) {
+    // one gyro LSB/16 for one sample is (1/16/lsb_per_dps/rate_hz) degrees, 2^32/360 binary angle per degree
+    a->gyro_k = (int32_t)lroundf(4294967296.0f / 360.0f / 16.0f / gyro_lsb_per_dps / rate_hz * 256.0f);
+    a->shift = (int)lroundf(log2f(time_constant_s * rate_hz));
+    if (a->shift < 1) a->shift = 1;
+    a->one_g = (int32_t)lroundf(accel_lsb_per_g);
+    a->roll = a->pitch = 0;
+    int i;
+    for (i = 0; i < 3; i++) {
+        a->bias[i] = 0;
+        a->rate[i] = 0;
+    }
+    a->rejected = 0;
+    a->cal_n = 0;
+    a->calibrated = false;
+}
+
+bool attitude_calibrate(attitude_t *a, const mpu6050_raw_t *raw) {
+    int i;
+    if (a->cal_n == 0) {
+        for (i = 0; i < 3; i++) {
+            a->cal_sum[i] = 0;
+            a->cal_min[i] = a->cal_max[i] = raw->gyro[i];
+        }
+    }
+    for (i = 0; i < 3; i++) {
+        a->cal_sum[i] += raw->gyro[i];
+        if (raw->gyro[i] < a->cal_min[i]) a->cal_min[i] = raw->gyro[i];
+        if (raw->gyro[i] > a->cal_max[i]) a->cal_max[i] = raw->gyro[i];
+        if (a->cal_max[i] - a->cal_min[i] > ATTITUDE_CAL_SPREAD) {
+            a->cal_n = 0; // it moved, the average would have the motion in it. Start over
+            return false;
+        }
+    }
+    if (++a->cal_n < ATTITUDE_CAL_SAMPLES) {
+        return false;
+    }
+    for (i = 0; i < 3; i++) {
+        a->bias[i] = a->cal_sum[i] * 16 / ATTITUDE_CAL_SAMPLES; // LSB/16
+    }
+    a->calibrated = true;
+    a->cal_n = 0;
+    attitude_level(a, raw);
+    return true;
+}
+
+// roll = atan2(ay, az), pitch = atan2(-ax, sqrt(ay^2 + az^2)). The first CORDIC hands over the
+// square root for free, only 1.647 times too long, so -ax gets the same stretch
+static void accel_angles(const mpu6050_raw_t *raw, angle_t *roll, angle_t *pitch) {
+    int32_t yz;
+    *roll = attitude_atan2(raw->accel[1] * ACCEL_SCALE, raw->accel[2] * ACCEL_SCALE, &yz);
+    int32_t x = (int32_t)(((int64_t)-raw->accel[0] * ACCEL_SCALE * CORDIC_GAIN_Q14) >> 14);
+    *pitch = attitude_atan2(x, yz, NULL);
+}
+
+void attitude_level(attitude_t *a, const mpu6050_raw_t *raw) {
+    accel_angles(raw, &a->roll, &a->pitch);
+}
+
+void attitude_update(attitude_t *a, const mpu6050_raw_t *raw) {
+    int i;
+    for (i = 0; i < 3; i++) {
+        a->rate[i] = raw->gyro[i] * 16 - a->bias[i];
+    }
+    int32_t p = a->rate[0], q = a->rate[1], r = a->rate[2];
+
+    // body rates to Euler angle rates:
+    //   roll'  = p + (q sin(roll) + r cos(roll)) tan(pitch)
+    //   pitch' = q cos(roll) - r sin(roll)
+    int32_t sr, cr, sp, cp;
+    attitude_sincos(a->roll, &sr, &cr);
+    attitude_sincos(a->pitch, &sp, &cp);
+    if (cp < ATTITUDE_MAX_COS) cp = ATTITUDE_MAX_COS; // pitch never gets past 90, this is the edge
+    int32_t tan_q15 = sp / (cp >> 15); // one 32 bit divide, the M33 does it in hardware
+    int32_t qr = (int32_t)(((int64_t)q * sr + (int64_t)r * cr) >> 30);
+    int64_t roll_rate = p + (((int64_t)qr * tan_q15) >> 15);
+    int64_t pitch_rate = ((int64_t)q * cr - (int64_t)r * sr) >> 30;
+    a->roll += (angle_t)((roll_rate * a->gyro_k) >> 8);
+    a->pitch += (angle_t)((pitch_rate * a->gyro_k) >> 8);
+
+    // only trust the accel while it reads about 1 g, otherwise it is measuring our own acceleration
+    int64_t g2 = (int64_t)raw->accel[0] * raw->accel[0] + (int64_t)raw->accel[1] * raw->accel[1]
+               + (int64_t)raw->accel[2] * raw->accel[2];
+    int64_t one = (int64_t)a->one_g * a->one_g;
+    if (g2 < one * 16 / 25 || g2 > one * 36 / 25) { // outside 0.8 to 1.2 g
+        a->rejected++;
+        return;
+    }
+    angle_t roll_acc, pitch_acc;
+    accel_angles(raw, &roll_acc, &pitch_acc);
+    a->roll += (angle_t)((uint32_t)roll_acc - (uint32_t)a->roll) >> a->shift; // the short way round
+    a->pitch += (angle_t)((uint32_t)pitch_acc - (uint32_t)a->pitch) >> a->shift;
+}
+
+float attitude_degrees(angle_t angle) {
+    return angle * (360.0f / 4294967296.0f);
+}
+
+float attitude_rate_dps(const attitude_t *a, int axis, float gyro_lsb_per_dps) {
+    return a->rate[axis] / 16.0f / gyro_lsb_per_dps;
+}
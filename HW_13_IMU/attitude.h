@@ -0,0 +1,56 @@
+// attitude.h
+// Roll and pitch from the MPU6050 at the full sample rate, fixed point so it costs the same
+// few hundred cycles every sample. A complementary filter: the gyro rates, turned into Euler
+// angle rates, carry the angles from one sample to the next and the gravity direction from
+// the accelerometer pulls them back a little every sample so the gyro can't drift away.
+//
+// Angles are binary angles, 2^32 is a full turn, so they wrap like the angles do and the
+// difference of two is always the short way round. Sines and arctangents are CORDIC, a fixed
+// 16 steps of shift and add.
+//
+//   attitude_t att;
+//   attitude_init(&att, mpu6050_gyro_lsb_per_dps(), mpu6050_accel_lsb_per_g(), 1000, 0.5f);
+//   while (!attitude_calibrate(&att, &raw)) ... next sample, hold it still
+//   attitude_update(&att, &raw); // every sample after that
+#ifndef ATTITUDE_H
+#define ATTITUDE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mpu6050.h"
+
+typedef int32_t angle_t; // binary angle, 2^32 is a full turn
+
+#define ANGLE_QUARTER_TURN 0x40000000
+#define ATTITUDE_CAL_SAMPLES 512   // gyro bias average, half a second at 1 kHz
+#define ATTITUDE_CAL_SPREAD 48     // LSB, more than this between the smallest and largest reading means it moved
+#define ATTITUDE_MAX_COS 0x00B2D6E1 // cos(89.4 deg) in Q30, pitch past this doesn't divide by ~0
+
+typedef struct {
+    int32_t gyro_k;     // binary angle per sample per gyro LSB/16, Q8
+    int32_t bias[3];    // gyro bias, LSB/16
+    int shift;          // accel pulls the angles 1/2^shift of the way every sample
+    int32_t one_g;      // accel LSB per g
+    angle_t roll, pitch;
+    int32_t rate[3];    // last bias corrected gyro, LSB/16. rate[2] is the yaw rate in the sensor frame
+    uint32_t rejected;  // samples the accel was ignored, not close enough to 1 g to be gravity
+
+    // calibration
+    int32_t cal_sum[3];
+    int16_t cal_min[3], cal_max[3];
+    int cal_n;
+    bool calibrated;
+} attitude_t;
+
+void attitude_init(attitude_t *a, float gyro_lsb_per_dps, float accel_lsb_per_g, unsigned int rate_hz, float time_constant_s);
+bool attitude_calibrate(attitude_t *a, const mpu6050_raw_t *raw); // true once it has the gyro bias
+void attitude_level(attitude_t *a, const mpu6050_raw_t *raw);     // angles straight from the accel, no filtering
+void attitude_update(attitude_t *a, const mpu6050_raw_t *raw);
+float attitude_degrees(angle_t angle);
+float attitude_rate_dps(const attitude_t *a, int axis, float gyro_lsb_per_dps);
+
+// the CORDIC parts, x and y up to about 2^24
+angle_t attitude_atan2(int32_t y, int32_t x, int32_t *magnitude); // magnitude comes out 1.647 times too big
+void attitude_sincos(angle_t angle, int32_t *sine, int32_t *cosine); // Q30
+
+#endif
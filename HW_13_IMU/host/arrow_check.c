@@ -0,0 +1,156 @@
+// arrow_check.c
+// ssd1306_draw_line/draw_arrow against the code HW_13 used before: Bresenham walking every
+// point of the line and the arrowhead from atan2/cos/sin in double. Both render through the
+// host port of the display library and the display memory is compared pixel for pixel
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "ssd1306.h"
+#include "ssd1306_host.h"
+#include "arrow_check.h"
+
+#define x_center 64 // HW_13_IMU.c
+#define y_center 16
+#define ARROW_HEAD 5
+
+static void reference_line(int x0, int y0, int x1, int y1, unsigned char color) {
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = (x0 < x1) ? 1 : -1;
+    int sy = (y0 < y1) ? 1 : -1;
+    int err = dx + dy;
+
+    while (1) {
+        if (x0 >= 0 && y0 >= 0) {
+            ssd1306_drawPixel(x0, y0, color);
+        }
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+static void reference_arrow(int x1, int y1) {
+    int x0 = x_center;
+    int y0 = y_center;
+    reference_line(x0, y0, x1, y1, 1);
+    float angle = atan2(y1 - y0, x1 - x0);
+    float arrow_length = 5.0;
+    float arrow_angle = M_PI / 6;
+    int x2 = x1 - (int)(arrow_length * cos(angle - arrow_angle));
+    int y2 = y1 - (int)(arrow_length * sin(angle - arrow_angle));
+    int x3 = x1 - (int)(arrow_length * cos(angle + arrow_angle));
+    int y3 = y1 - (int)(arrow_length * sin(angle + arrow_angle));
+    reference_line(x1, y1, x2, y2, 1);
+    reference_line(x1, y1, x3, y3, 1);
+}
+
+static void new_arrow(int x1, int y1) {
+    ssd1306_draw_arrow(x_center, y_center, x1, y1, ARROW_HEAD, 1);
+}
+
+static unsigned char shown[2][SSD1306_MAX_HEIGHT][SSD1306_WIDTH];
+
+static void snapshot(int which) {
+    ssd1306_update();
+    int x, y;
+    for (y = 0; y < ssd1306_height(); y++) {
+        for (x = 0; x < SSD1306_WIDTH; x++) {
+            shown[which][y][x] = (unsigned char)ssd1306_display_pixel(x, y);
+        }
+    }
+}
+
+static int differs(void) {
+    return memcmp(shown[0], shown[1], sizeof(shown[0])) != 0;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// the old line wraps x and y through unsigned char, so only compare where it didn't: below 256
+static int random_coord(void) {
+    return rand() % 556 - 300;
+}
+
+int arrow_check(int height) {
+    ssd1306_set_height((unsigned char)height);
+    ssd1306_setup();
+    int lines_bad = 0, arrows_bad = 0, n_lines = 0, n_arrows = 0;
+    int i;
+
+    // lines anywhere, on and off the screen, on every side
+    srand(1);
+    for (i = 0; i < 200000; i++) {
+        int x0 = random_coord(), y0 = random_coord();
+        int x1 = random_coord(), y1 = random_coord();
+        if (i % 4 == 0) { // most random lines miss a 128x32 screen, keep plenty that cross it
+            x0 = rand() % 200 - 36;
+            y0 = rand() % 120 - 44;
+        }
+        ssd1306_clear();
+        reference_line(x0, y0, x1, y1, 1);
+        snapshot(0);
+        ssd1306_clear();
+        ssd1306_draw_line(x0, y0, x1, y1, 1);
+        snapshot(1);
+        n_lines++;
+        if (differs()) {
+            if (lines_bad++ < 5) printf("line %d,%d %d,%d differs\n", x0, y0, x1, y1);
+        }
+    }
+
+    // every arrow tip HW_13 can draw up to 2 g (C = 30), and further
+    int dx, dy;
+    for (dy = -70; dy <= 70; dy++) {
+        for (dx = -70; dx <= 70; dx++) {
+            ssd1306_clear();
+            reference_arrow(x_center + dx, y_center + dy);
+            snapshot(0);
+            ssd1306_clear();
+            new_arrow(x_center + dx, y_center + dy);
+            snapshot(1);
+            n_arrows++;
+            if (differs()) {
+                if (arrows_bad++ < 5) printf("arrow to %+d,%+d differs\n", dx, dy);
+            }
+        }
+    }
+    printf("128x%d: %d of %d lines and %d of %d arrows differ from the old rendering\n", height, lines_bad, n_lines, arrows_bad, n_arrows);
+
+    // drawing only, no update: the arrow for every tip within 2 g, over and over
+    const int reps = 20;
+    double t0 = now_s();
+    int r;
+    for (r = 0; r < reps; r++) {
+        for (dy = -60; dy <= 60; dy += 3) {
+            for (dx = -60; dx <= 60; dx += 3) {
+                reference_arrow(x_center + dx, y_center + dy);
+            }
+        }
+    }
+    double t1 = now_s();
+    for (r = 0; r < reps; r++) {
+        for (dy = -60; dy <= 60; dy += 3) {
+            for (dx = -60; dx <= 60; dx += 3) {
+                new_arrow(x_center + dx, y_center + dy);
+            }
+        }
+    }
+    double t2 = now_s();
+    int count = reps * 41 * 41;
+    printf("arrow: atan2/cos/sin %.0f ns, integer %.0f ns on this machine\n", (t1 - t0) / count * 1e9, (t2 - t1) / count * 1e9);
+    return (lines_bad || arrows_bad) ? 1 : 0;
+}
@@ -0,0 +1,9 @@
+// arrow_check.h
+#ifndef ARROW_CHECK_H
+#define ARROW_CHECK_H
+
+// pixel for pixel comparison and timing of the integer arrow against the old float one,
+// returns 0 if every picture matched
+int arrow_check(int height);
+
+#endif
@@ -0,0 +1,211 @@
+// imu_tool.c
+// Host side of the IMU project, runs the MPU6050 driver against the register file in
+// mpu6050_host.c instead of the chip.
+//
+//   imu_tool --check          burst parsing, scaling and the FIFO on known register contents
+//   imu_tool --rate [baud]    bus time of one burst and the sample rate it allows
+//   imu_tool --replay log.csv [--rate-hz n]
+//                             attitude.c on a recorded log next to a float reference
+//   imu_tool --synth log.csv [--seconds s] [--rate-hz n] [--seed n]
+//                             a made up log with the true angles, for --replay
+//   imu_tool --check-arrow    the OLED arrow against the old atan2/cos/sin one, pixel for pixel
+//   imu_tool --check-text     OLED text against the old per-pixel drawLetter, pixel for pixel, and its speed
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "mpu6050.h"
+#include "mpu6050_host.h"
+#include "replay.h"
+#include "arrow_check.h"
+#include "text_check.h"
+
+static void usage(void) {
+    fprintf(stderr, "usage: imu_tool --check\n"
+                    "       imu_tool --rate [baud]\n"
+                    "       imu_tool --replay log.csv [--rate-hz n]\n"
+                    "       imu_tool --synth log.csv [--seconds s] [--rate-hz n] [--seed n]\n"
+                    "       imu_tool --check-arrow\n"
+                    "       imu_tool --check-text\n");
+    exit(2);
+}
+
+static int failures = 0;
+
+static void expect(const char *what, float got, float want, float tolerance) {
+    if (fabsf(got - want) > tolerance) {
+        printf("FAIL %s: %g, expected %g\n", what, got, want);
+        failures++;
+    }
+}
+
+static mpu6050_raw_t numbered(int i) {
+    mpu6050_raw_t raw = {{(int16_t)i, (int16_t)-i, (int16_t)(i * 100)}, (int16_t)(-i * 3), {(int16_t)(i + 7), 0, (int16_t)-32768}};
+    return raw;
+}
+
+// samples queued by the chip come back out in order and whole, an overflow is reported once
+static void check_fifo(void) {
+    mpu6050_host_reset();
+    mpu6050_setup(MPU6050_ACCEL_2G, MPU6050_GYRO_2000DPS);
+    expect("start_fifo 1 kHz", mpu6050_start_fifo(1000, 1), 1000, 0);
+    expect("SMPLRT_DIV", mpu6050_host_register(MPU6050_SMPLRT_DIV), 0, 0);
+    expect("CONFIG", mpu6050_host_register(MPU6050_CONFIG), 1, 0);
+    expect("start_fifo 300 Hz", mpu6050_start_fifo(300, 3), 333, 0); // nearest divider
+    expect("start_fifo 2 kHz", mpu6050_start_fifo(2000, 1), 0, 0);
+    expect("start_fifo 1 kHz", mpu6050_start_fifo(1000, 1), 1000, 0);
+    // INT pulses once per sample and nothing but reading INT_STATUS clears it
+    expect("INT_ENABLE", mpu6050_host_register(MPU6050_INT_ENABLE), MPU6050_INT_DATA_RDY, 0);
+    expect("INT_PIN_CFG", mpu6050_host_register(MPU6050_INT_PIN_CFG) & MPU6050_INT_RD_CLEAR, 0, 0);
+
+    mpu6050_raw_t got[80];
+    int i, n;
+    for (i = 0; i < 10; i++) {
+        mpu6050_raw_t raw = numbered(i);
+        mpu6050_host_sample(&raw);
+    }
+    expect("fifo count", mpu6050_fifo_count(), 10 * MPU6050_BURST_LEN, 0);
+    expect("fifo_samples", mpu6050_fifo_samples(), 10, 0);
+    expect("fifo_read 4", mpu6050_fifo_read(got, 4), 4, 0);
+    n = mpu6050_fifo_read(got + 4, mpu6050_fifo_samples());
+    expect("fifo_read rest", n, 6, 0);
+    for (i = 0; i < 10; i++) {
+        mpu6050_raw_t want = numbered(i);
+        if (memcmp(&got[i], &want, sizeof(want)) != 0) {
+            printf("FAIL fifo sample %d out of order or torn\n", i);
+            failures++;
+        }
+    }
+
+    // 80 samples is more than the 1024 bytes the FIFO holds
+    for (i = 0; i < 80; i++) {
+        mpu6050_raw_t raw = numbered(i);
+        mpu6050_host_sample(&raw);
+    }
+    expect("fifo_samples after overflow", mpu6050_fifo_samples(), -1, 0);
+    expect("fifo empty after overflow", mpu6050_fifo_count(), 0, 0);
+    for (i = 0; i < 3; i++) {
+        mpu6050_raw_t raw = numbered(100 + i);
+        mpu6050_host_sample(&raw);
+    }
+    expect("fifo_samples after reset", mpu6050_fifo_samples(), 3, 0);
+    expect("fifo_read after reset", mpu6050_fifo_read(got, 3), 3, 0);
+    mpu6050_raw_t want = numbered(100);
+    if (memcmp(&got[0], &want, sizeof(want)) != 0) {
+        printf("FAIL fifo doesn't start on a sample after the reset\n");
+        failures++;
+    }
+}
+
+// the same sample at every full scale setting: raw counts that should come out as round numbers
+static int check(void) {
+    static const struct {
+        mpu6050_accel_range_t accel;
+        mpu6050_gyro_range_t gyro;
+        float g_per_lsb, dps_per_lsb;
+    } ranges[] = {
+        {MPU6050_ACCEL_2G, MPU6050_GYRO_250DPS, 1.0f / 16384, 1.0f / 131},
+        {MPU6050_ACCEL_4G, MPU6050_GYRO_500DPS, 1.0f / 8192, 1.0f / 65.5f},
+        {MPU6050_ACCEL_8G, MPU6050_GYRO_1000DPS, 1.0f / 4096, 1.0f / 32.8f},
+        {MPU6050_ACCEL_16G, MPU6050_GYRO_2000DPS, 1.0f / 2048, 1.0f / 16.4f},
+    };
+    // negative and full scale values catch sign extension and byte order mistakes
+    const mpu6050_raw_t raw = {{16384, -8192, 32767}, -521, {131, -32768, 0x0102}};
+    unsigned int i;
+
+    for (i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        mpu6050_host_reset();
+        if (!mpu6050_setup(ranges[i].accel, ranges[i].gyro)) {
+            printf("FAIL setup: WHO_AM_I not accepted\n");
+            return 1;
+        }
+        expect("PWR_MGMT_1 awake", mpu6050_host_register(MPU6050_PWR_MGMT_1), 0, 0);
+        expect("ACCEL_CONFIG", mpu6050_host_register(MPU6050_ACCEL_CONFIG), ranges[i].accel << 3, 0);
+        expect("GYRO_CONFIG", mpu6050_host_register(MPU6050_GYRO_CONFIG), ranges[i].gyro << 3, 0);
+
+        mpu6050_host_load(&raw);
+        unsigned long before = mpu6050_host_transactions();
+        mpu6050_raw_t got;
+        mpu6050_sample_t s;
+        if (!mpu6050_read(&got)) {
+            printf("FAIL read\n");
+            return 1;
+        }
+        expect("transactions per sample", (float)(mpu6050_host_transactions() - before), 1, 0);
+        if (memcmp(&got, &raw, sizeof(raw)) != 0) {
+            printf("FAIL parse: burst doesn't match the registers\n");
+            failures++;
+        }
+
+        mpu6050_scale(&got, &s);
+        int axis;
+        for (axis = 0; axis < 3; axis++) {
+            expect("accel", s.accel[axis], raw.accel[axis] * ranges[i].g_per_lsb, 1e-4f);
+            expect("gyro", s.gyro[axis], raw.gyro[axis] * ranges[i].dps_per_lsb, 0.05f);
+        }
+        expect("temp", s.temp, 35.0f, 0.01f); // -521 counts is 35 C
+    }
+    expect("sizeof(mpu6050_raw_t)", sizeof(mpu6050_raw_t), MPU6050_BURST_LEN, 0);
+
+    // the byte layout on the bus, straight from the register map: ACCEL_XOUT_H first
+    mpu6050_host_reset();
+    mpu6050_setup(MPU6050_ACCEL_2G, MPU6050_GYRO_250DPS);
+    mpu6050_host_set_register(MPU6050_ACCEL_XOUT_H, 0xC0);
+    mpu6050_host_set_register(MPU6050_ACCEL_XOUT_H + 1, 0x00);
+    mpu6050_host_set_register(MPU6050_GYRO_XOUT_H + 4, 0x00); // GYRO_ZOUT_H
+    mpu6050_host_set_register(MPU6050_GYRO_XOUT_H + 5, 0x83); // GYRO_ZOUT_L
+    mpu6050_raw_t got;
+    mpu6050_read(&got);
+    expect("ACCEL_XOUT 0xC000", got.accel[0], -16384, 0);
+    expect("GYRO_ZOUT 0x0083", got.gyro[2], 131, 0);
+
+    check_fifo();
+
+    if (failures == 0) {
+        printf("ok\n");
+    }
+    return failures ? 1 : 0;
+}
+
+static int rate(unsigned int baud) {
+    float us = mpu6050_burst_us(baud);
+    printf("%u Hz: one 14 byte burst is %.0f us on the bus, %.0f samples/s at most\n", baud, us, 1e6f / us);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "--check") == 0) {
+        return check();
+    }
+    if (argc >= 2 && strcmp(argv[1], "--check-arrow") == 0) {
+        return arrow_check(32) | arrow_check(64);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--check-text") == 0) {
+        return text_check(32) | text_check(64);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--rate") == 0) {
+        return rate(argc >= 3 ? (unsigned int)atoi(argv[2]) : 400000);
+    }
+    if (argc >= 3 && (strcmp(argv[1], "--replay") == 0 || strcmp(argv[1], "--synth") == 0)) {
+        unsigned int rate_hz = 1000, seed = 1;
+        float seconds = 20;
+        int i;
+        for (i = 3; i < argc; i++) {
+            if (i + 1 < argc && strcmp(argv[i], "--rate-hz") == 0) {
+                rate_hz = (unsigned int)atoi(argv[++i]);
+            } else if (i + 1 < argc && strcmp(argv[i], "--seconds") == 0) {
+                seconds = (float)atof(argv[++i]);
+            } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+                seed = (unsigned int)atoi(argv[++i]);
+            } else {
+                usage();
+            }
+        }
+        if (argv[1][2] == 'r') {
+            return replay_log(argv[2], rate_hz);
+        }
+        return synth_log(argv[2], seconds, rate_hz, seed);
+    }
+    usage();
+    return 2;
+}
@@ -0,0 +1,235 @@
+// replay.c
+// IMU logs through attitude.c next to a float reference, see replay.h
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "attitude.h"
+#include "replay.h"
+
+#define ACCEL_LSB_PER_G 16384.0f // MPU6050_ACCEL_2G
+#define GYRO_LSB_PER_DPS 16.4f   // MPU6050_GYRO_2000DPS
+#define TIME_CONSTANT_S 0.5f     // ATTITUDE_TIME_CONSTANT in HW_13_IMU.c
+#define DEG (3.14159265358979f / 180.0f)
+
+typedef struct {
+    unsigned long long time_us;
+    mpu6050_raw_t raw;
+    float roll, pitch; // degrees, only when has_truth
+    int has_truth;
+} log_sample_t;
+
+static int read_sample(FILE *f, log_sample_t *s) {
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        int v[7];
+        float roll, pitch;
+        int n = sscanf(line, "%llu,%d,%d,%d,%d,%d,%d,%d,%f,%f", &s->time_us, &v[0], &v[1], &v[2], &v[3],
+                       &v[4], &v[5], &v[6], &roll, &pitch);
+        if (n < 8) {
+            continue; // header, or whatever else the board printed
+        }
+        int i;
+        for (i = 0; i < 3; i++) {
+            s->raw.accel[i] = (int16_t)v[i];
+            s->raw.gyro[i] = (int16_t)v[4 + i];
+        }
+        s->raw.temp = (int16_t)v[3];
+        s->has_truth = (n == 10);
+        s->roll = roll;
+        s->pitch = pitch;
+        return 1;
+    }
+    return 0;
+}
+
+// attitude_update() in float, same equations and the same accel gate
+typedef struct {
+    float roll, pitch; // radians
+    float bias[3];     // LSB
+    float k;           // accel weight per sample
+    float dt;
+} reference_t;
+
+static float wrap(float a) {
+    while (a > (float)M_PI) a -= 2 * (float)M_PI;
+    while (a < -(float)M_PI) a += 2 * (float)M_PI;
+    return a;
+}
+
+static void reference_update(reference_t *f, const mpu6050_raw_t *raw) {
+    float p = (raw->gyro[0] - f->bias[0]) / GYRO_LSB_PER_DPS * DEG;
+    float q = (raw->gyro[1] - f->bias[1]) / GYRO_LSB_PER_DPS * DEG;
+    float r = (raw->gyro[2] - f->bias[2]) / GYRO_LSB_PER_DPS * DEG;
+    float roll_rate = p + (q * sinf(f->roll) + r * cosf(f->roll)) * tanf(f->pitch);
+    float pitch_rate = q * cosf(f->roll) - r * sinf(f->roll);
+    f->roll = wrap(f->roll + roll_rate * f->dt);
+    f->pitch += pitch_rate * f->dt;
+
+    float ax = raw->accel[0], ay = raw->accel[1], az = raw->accel[2];
+    float g = sqrtf(ax*ax + ay*ay + az*az) / ACCEL_LSB_PER_G;
+    if (g < 0.8f || g > 1.2f) {
+        return;
+    }
+    float roll_acc = atan2f(ay, az);
+    float pitch_acc = atan2f(-ax, sqrtf(ay*ay + az*az));
+    f->roll = wrap(f->roll + wrap(roll_acc - f->roll) * f->k);
+    f->pitch += (pitch_acc - f->pitch) * f->k;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    double sum2;
+    float max;
+    long n;
+} error_t;
+
+static void add_error(error_t *e, float deg) {
+    deg = fabsf(deg);
+    e->sum2 += (double)deg * deg;
+    if (deg > e->max) e->max = deg;
+    e->n++;
+}
+
+static void print_error(const char *what, const error_t *roll, const error_t *pitch) {
+    printf("%s: roll rms %.3f max %.3f deg, pitch rms %.3f max %.3f deg\n", what,
+           sqrt(roll->sum2 / roll->n), roll->max, sqrt(pitch->sum2 / pitch->n), pitch->max);
+}
+
+int replay_log(const char *path, unsigned int rate_hz) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "can't open %s\n", path);
+        return 1;
+    }
+    attitude_t att;
+    attitude_init(&att, GYRO_LSB_PER_DPS, ACCEL_LSB_PER_G, rate_hz, TIME_CONSTANT_S);
+    log_sample_t s;
+    long cal = 0;
+    while (read_sample(f, &s)) {
+        cal++;
+        if (attitude_calibrate(&att, &s.raw)) {
+            break;
+        }
+    }
+    if (!att.calibrated) {
+        fprintf(stderr, "%s: never held still for %d samples, no gyro bias\n", path, ATTITUDE_CAL_SAMPLES);
+        fclose(f);
+        return 1;
+    }
+    printf("gyro bias %.2f %.2f %.2f LSB after %ld samples\n", att.bias[0] / 16.0f, att.bias[1] / 16.0f,
+           att.bias[2] / 16.0f, cal);
+
+    // the reference starts where the filter does, so only the filter arithmetic is compared
+    reference_t ref;
+    int i;
+    for (i = 0; i < 3; i++) {
+        ref.bias[i] = att.bias[i] / 16.0f;
+    }
+    ref.roll = attitude_degrees(att.roll) * DEG;
+    ref.pitch = attitude_degrees(att.pitch) * DEG;
+    ref.k = 1.0f / (1 << att.shift);
+    ref.dt = 1.0f / rate_hz;
+
+    error_t vs_ref_roll = {0}, vs_ref_pitch = {0}, vs_true_roll = {0}, vs_true_pitch = {0};
+    error_t ref_true_roll = {0}, ref_true_pitch = {0};
+    double update_s = 0;
+    long n = 0;
+    while (read_sample(f, &s)) {
+        double t0 = now_s();
+        attitude_update(&att, &s.raw);
+        update_s += now_s() - t0;
+        reference_update(&ref, &s.raw);
+        n++;
+
+        float roll = attitude_degrees(att.roll), pitch = attitude_degrees(att.pitch);
+        add_error(&vs_ref_roll, wrap((roll - ref.roll / DEG) * DEG) / DEG);
+        add_error(&vs_ref_pitch, pitch - ref.pitch / DEG);
+        if (s.has_truth) {
+            add_error(&vs_true_roll, wrap((roll - s.roll) * DEG) / DEG);
+            add_error(&vs_true_pitch, pitch - s.pitch);
+            add_error(&ref_true_roll, wrap(ref.roll - s.roll * DEG) / DEG);
+            add_error(&ref_true_pitch, ref.pitch / DEG - s.pitch);
+        }
+    }
+    fclose(f);
+    if (n == 0) {
+        fprintf(stderr, "%s: nothing after the calibration\n", path);
+        return 1;
+    }
+    printf("%ld samples, accel ignored for %lu, %.0f ns per update on this machine\n", n,
+           (unsigned long)att.rejected, update_s / n * 1e9);
+    print_error("fixed point vs float", &vs_ref_roll, &vs_ref_pitch);
+    if (vs_true_roll.n) {
+        print_error("fixed point vs truth", &vs_true_roll, &vs_true_pitch);
+        print_error("float vs truth", &ref_true_roll, &ref_true_pitch);
+    }
+    return 0;
+}
+
+static float noise(float sd) {
+    // sum of 12 uniforms, close enough to normal
+    float sum = 0;
+    int i;
+    for (i = 0; i < 12; i++) {
+        sum += (float)rand() / RAND_MAX;
+    }
+    return (sum - 6.0f) * sd;
+}
+
+static int16_t counts(float v) {
+    float c = roundf(v);
+    if (c > 32767) c = 32767;
+    if (c < -32768) c = -32768;
+    return (int16_t)c;
+}
+
+int synth_log(const char *path, float seconds, unsigned int rate_hz, unsigned int seed) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "can't write %s\n", path);
+        return 1;
+    }
+    srand(seed);
+    const float still_s = 1.0f;
+    const float bias_dps[3] = {1.5f, -2.0f, 0.7f};
+    float dt = 1.0f / rate_hz;
+    long n = (long)(seconds * rate_hz), i;
+    fprintf(f, "time_us,ax,ay,az,temp,gx,gy,gz,roll_deg,pitch_deg\n");
+    for (i = 0; i < n; i++) {
+        float t = i * dt, m = t - still_s;
+        float roll = 0, pitch = 0, roll_rate = 0, pitch_rate = 0; // rad, rad/s
+        if (m > 0) {
+            // rolling past +-60 and pitching +-35, with a quick wobble on top
+            roll = 60 * DEG * sinf(2 * (float)M_PI * 0.4f * m) + 5 * DEG * sinf(2 * (float)M_PI * 7 * m);
+            roll_rate = 60 * DEG * 2 * (float)M_PI * 0.4f * cosf(2 * (float)M_PI * 0.4f * m)
+                      + 5 * DEG * 2 * (float)M_PI * 7 * cosf(2 * (float)M_PI * 7 * m);
+            pitch = 35 * DEG * sinf(2 * (float)M_PI * 0.25f * m);
+            pitch_rate = 35 * DEG * 2 * (float)M_PI * 0.25f * cosf(2 * (float)M_PI * 0.25f * m);
+        }
+        // Euler rates back to body rates (no yaw): p = roll', q = pitch' cos(roll), r = -pitch' sin(roll)
+        float gyro[3] = {roll_rate, pitch_rate * cosf(roll), -pitch_rate * sinf(roll)};
+        // gravity as the accelerometer sees it, plus a shake now and then that isn't gravity
+        float accel[3] = {-sinf(pitch), sinf(roll) * cosf(pitch), cosf(roll) * cosf(pitch)};
+        if (m > 0 && fmodf(m, 3.0f) < 0.05f) {
+            accel[0] += 0.8f;
+        }
+        fprintf(f, "%llu", (unsigned long long)(i * 1000000ULL / rate_hz));
+        int k;
+        for (k = 0; k < 3; k++) {
+            fprintf(f, ",%d", counts(accel[k] * ACCEL_LSB_PER_G + noise(40)));
+        }
+        fprintf(f, ",%d", counts((25.0f - 36.53f) * 340)); // 25 C
+        for (k = 0; k < 3; k++) {
+            fprintf(f, ",%d", counts((gyro[k] / DEG + bias_dps[k]) * GYRO_LSB_PER_DPS + noise(2)));
+        }
+        fprintf(f, ",%.4f,%.4f\n", roll / DEG, pitch / DEG);
+    }
+    return fclose(f) == 0 ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+// replay.h
+// IMU logs through the attitude filter. A log is CSV, one sample per line:
+//   time_us,ax,ay,az,temp,gx,gy,gz[,roll_deg,pitch_deg]
+// raw counts at the ranges HW_13 sets (2 g, 2000 dps), the way the robot prints them with 'l'.
+// Synthetic logs also carry the true angles in the last two columns
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// calibrate on the first still samples, then run the fixed point filter and a float copy of
+// it side by side and print how far apart they get (and from the truth, when the log has it)
+int replay_log(const char *path, unsigned int rate_hz);
+
+// a still start and then rolling and pitching with gyro bias and noise, for trying the filter
+// without the board
+int synth_log(const char *path, float seconds, unsigned int rate_hz, unsigned int seed);
+
+#endif
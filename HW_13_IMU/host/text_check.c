@@ -0,0 +1,159 @@
+// text_check.c
+// ssd1306_draw_char/draw_string against the drawLetter/drawmytext HW7, HW13 and HW17 carried
+// before: 40 drawPixel calls per glyph. Both render through the host port of the display
+// library over the same random background and the display memory is compared pixel for pixel
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ssd1306.h"
+#include "ssd1306_host.h"
+#include "font.h"
+#include "text_check.h"
+
+static void reference_letter(int x, int y, char c) {
+    int index = c - 0x20; // 0x20 is the ASCII value of the space character
+    if (index < 0 || index >= 96) return; // skip unprintables
+
+    for (int i = 0; i < 5; i++) { // loop through the columns of the character
+        char col = ASCII[index][i];
+        for (int j = 0; j < 8; j++) { // loop through the rows of the character
+            char on = (col >> j) & 0b1;
+            ssd1306_drawPixel(x + i, y + j, on);
+        }
+    }
+}
+
+static void reference_text(int x, int y, const char *m) {
+    int i = 0; // index of the character in the string
+    int startX = x; // save the initial x position
+    while (m[i] != '\0') { // loop through every character in the string
+        if (x + 5 >= ssd1306_width()) {
+            x = startX;      // Reset to initial x
+            y += 8;          // Move to next row (each char is 8 pixels tall)
+            if (y + 8 > ssd1306_height()) break; // Don't draw below the screen
+        }
+        reference_letter(x, y, m[i]);
+        x += 6; // Move to next character (5 pixels + 1 spacing)
+        i++;
+    }
+}
+
+static unsigned char shown[2][SSD1306_MAX_HEIGHT][SSD1306_WIDTH];
+
+static void snapshot(int which) {
+    ssd1306_update();
+    int x, y;
+    for (y = 0; y < ssd1306_height(); y++) {
+        for (x = 0; x < SSD1306_WIDTH; x++) {
+            shown[which][y][x] = (unsigned char)ssd1306_display_pixel(x, y);
+        }
+    }
+}
+
+static int differs(void) {
+    return memcmp(shown[0], shown[1], sizeof(shown[0])) != 0;
+}
+
+// the glyphs have to keep what is around them, so they go over noise rather than a clear screen
+static void background(unsigned int seed) {
+    srand(seed);
+    int x, y;
+    for (y = 0; y < ssd1306_height(); y++) {
+        for (x = 0; x < SSD1306_WIDTH; x++) {
+            ssd1306_drawPixel(x, y, rand() & 1);
+        }
+    }
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// the old letter wraps x and y through unsigned char, so stay well inside where it didn't
+static int random_x(void) {
+    return rand() % (SSD1306_WIDTH + 20) - 10;
+}
+
+static int random_y(void) {
+    return rand() % (ssd1306_height() + 20) - 10;
+}
+
+// a typical HW_17 row, 19 characters still fit at x = 2 so neither version wraps
+static const char dashboard[] = "Gain: 0.25 PWM L:60";
+
+// ns per character for one y, the row drawn over and over without an update
+static void time_text(int y, const char *name) {
+    const int reps = 200000;
+    int len = (int)strlen(dashboard);
+    int r;
+    double t0 = now_s();
+    for (r = 0; r < reps; r++) {
+        reference_text(2, y, dashboard);
+    }
+    double t1 = now_s();
+    for (r = 0; r < reps; r++) {
+        ssd1306_draw_string(2, y, dashboard);
+    }
+    double t2 = now_s();
+    double old_ns = (t1 - t0) / ((double)reps * len) * 1e9, new_ns = (t2 - t1) / ((double)reps * len) * 1e9;
+    printf("text %s y=%d: drawLetter %.1f ns/char, draw_char %.1f ns/char (%.1fx) on this machine\n",
+           name, y, old_ns, new_ns, old_ns / new_ns);
+}
+
+int text_check(int height) {
+    ssd1306_set_height((unsigned char)height);
+    ssd1306_setup();
+    int chars_bad = 0, strings_bad = 0, n_chars = 0, n_strings = 0;
+    int i;
+
+    // single glyphs, any printable and a few that aren't, on and off every edge
+    srand(1);
+    for (i = 0; i < 3000; i++) {
+        int x = random_x(), y = random_y();
+        char c = (char)(rand() % 100 + 0x1E);
+        unsigned int seed = (unsigned int)rand();
+        background(seed);
+        reference_letter(x, y, c);
+        snapshot(0);
+        background(seed);
+        ssd1306_draw_char(x, y, c);
+        snapshot(1);
+        srand(seed + i); // background() reseeded, move on from somewhere new
+        n_chars++;
+        if (differs()) {
+            if (chars_bad++ < 5) printf("char 0x%02X at %d,%d differs\n", (unsigned char)c, x, y);
+        }
+    }
+
+    // strings long enough to wrap, from anywhere on the screen
+    for (i = 0; i < 500; i++) {
+        char m[48];
+        int len = rand() % (int)(sizeof(m) - 1), j;
+        for (j = 0; j < len; j++) {
+            m[j] = (char)(rand() % 95 + 0x20);
+        }
+        m[len] = '\0';
+        int x = rand() % SSD1306_WIDTH, y = rand() % ssd1306_height();
+        unsigned int seed = (unsigned int)rand();
+        background(seed);
+        reference_text(x, y, m);
+        snapshot(0);
+        background(seed);
+        ssd1306_draw_string(x, y, m);
+        snapshot(1);
+        srand(seed + i);
+        n_strings++;
+        if (differs()) {
+            if (strings_bad++ < 5) printf("string \"%s\" at %d,%d differs\n", m, x, y);
+        }
+    }
+    printf("128x%d: %d of %d chars and %d of %d strings differ from the old rendering\n",
+           height, chars_bad, n_chars, strings_bad, n_strings);
+
+    time_text(8, "aligned");
+    time_text(3, "unaligned");
+    return (chars_bad || strings_bad) ? 1 : 0;
+}
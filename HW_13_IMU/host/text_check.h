@@ -0,0 +1,9 @@
+// text_check.h
+#ifndef TEXT_CHECK_H
+#define TEXT_CHECK_H
+
+// pixel for pixel comparison and timing of ssd1306_draw_char/draw_string against the old
+// per-pixel drawLetter/drawmytext, returns 0 if every picture matched
+int text_check(int height);
+
+#endif
@@ -0,0 +1,109 @@
+// imu_stream.c
+// FIFO and data ready streaming, see imu_stream.h
+#include "imu_stream.h"
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+
+// written by the interrupt, one time per data ready pulse
+static volatile uint64_t int_times[IMU_TIMES_LEN];
+static volatile uint32_t int_count = 0;
+
+static imu_sample_t ring[IMU_STREAM_LEN];
+static uint32_t ring_head = 0, ring_tail = 0; // free running, head - tail is the fill
+static uint32_t overflows = 0, dropped = 0;
+static uint32_t period_us = 1000;
+static uint32_t drained = 0; // int_count the last batch was matched up to
+
+static void imu_int_callback(uint gpio, uint32_t events) {
+    int_times[int_count % IMU_TIMES_LEN] = time_us_64();
+    int_count++;
+}
+
+unsigned int imu_stream_start(unsigned int int_pin, unsigned int rate_hz) {
+    unsigned int rate = mpu6050_start_fifo(rate_hz, 1); // 188 Hz DLPF, sampling off 1 kHz
+    if (rate == 0) {
+        return 0;
+    }
+    period_us = 1000000 / rate;
+    ring_head = ring_tail = 0;
+    overflows = dropped = 0;
+    drained = int_count;
+
+    gpio_init(int_pin);
+    gpio_set_dir(int_pin, GPIO_IN);
+    gpio_pull_down(int_pin);
+    gpio_set_irq_enabled_with_callback(int_pin, GPIO_IRQ_EDGE_RISE, true, &imu_int_callback);
+    return rate;
+}
+
+int imu_stream_poll() {
+    static mpu6050_raw_t batch[MPU6050_FIFO_SIZE / MPU6050_BURST_LEN];
+    // before the count: taken after, a pulse that comes in between would be counted without its
+    // sample and every timestamp would shift one period late. This way the count can only be ahead
+    uint32_t pulses = int_count;
+    __dmb();
+    int n = mpu6050_fifo_samples();
+    if (n < 0) {
+        overflows++;
+        drained = pulses;
+        return 0;
+    }
+    bool pulsed = pulses != drained;
+    if (pulsed && (uint32_t)n == pulses - drained + 1) {
+        n--; // its pulse came after the snapshot, the sample waits in the FIFO for the next poll
+    }
+    if (n == 0) {
+        return 0;
+    }
+    // more arrive while the batch goes over the bus (a 1 kHz sample every 390 us of burst),
+    // they stay in the FIFO for the next poll
+    n = mpu6050_fifo_read(batch, n);
+
+    // the newest sample in the batch goes with the newest pulse and the rest count back from
+    // there. If the pulses don't add up (missed edge, too long a gap) space them by the period.
+    // With no new pulse at all (INT not wired, the first poll after the start) int_times has
+    // nothing for them and now is the best guess for the newest
+    __dmb();
+    uint64_t last = pulsed ? int_times[(pulses - 1) % IMU_TIMES_LEN] : time_us_64();
+    bool matched = pulsed && (pulses - drained >= (uint32_t)n) && n <= IMU_TIMES_LEN;
+    int i;
+    for (i = 0; i < n; i++) {
+        if (ring_head - ring_tail == IMU_STREAM_LEN) {
+            ring_tail++; // keep the newest, the reader fell behind
+            dropped++;
+        }
+        imu_sample_t *s = &ring[ring_head % IMU_STREAM_LEN];
+        s->raw = batch[i];
+        s->time_us = matched ? int_times[(pulses - n + i) % IMU_TIMES_LEN]
+                             : last - (uint64_t)(n - 1 - i) * period_us;
+        ring_head++;
+    }
+    drained = pulses;
+    return n;
+}
+
+bool imu_stream_get(imu_sample_t *s) {
+    if (ring_tail == ring_head) {
+        return false;
+    }
+    *s = ring[ring_tail % IMU_STREAM_LEN];
+    ring_tail++;
+    return true;
+}
+
+int imu_stream_available() {
+    return (int)(ring_head - ring_tail);
+}
+
+uint32_t imu_stream_overflows() {
+    return overflows;
+}
+
+uint32_t imu_stream_dropped() {
+    return dropped;
+}
+
+uint32_t imu_stream_interrupts() {
+    return int_count;
+}
@@ -0,0 +1,38 @@
+// imu_stream.h
+// MPU6050 sampling at its own rate (FIFO mode) instead of one read per loop. The chip queues
+// every sample and pulses INT, the GPIO interrupt only timestamps the pulse. The FIFO is
+// drained from the loop because the bus is shared with the OLED DMA, a whole batch at a time
+// into a ring buffer, and each sample gets the time of its own pulse
+//
+//   imu_stream_start(IMU_INT_PIN, 1000);
+//   while (true) {
+//       scheduler_wait(&sched);     // 30 Hz is plenty, the FIFO holds 73 samples
+//       imu_stream_poll();          // bus must be free, call it before ssd1306_update()
+//       imu_sample_t s;
+//       while (imu_stream_get(&s)) ... every sample, in order
+//   }
+#ifndef IMU_STREAM_H
+#define IMU_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mpu6050.h"
+
+#define IMU_STREAM_LEN 256 // samples, power of 2. 256 ms at 1 kHz
+#define IMU_TIMES_LEN 128  // interrupt times kept, more than the FIFO holds
+
+typedef struct {
+    mpu6050_raw_t raw;
+    uint64_t time_us; // when the chip said it was ready
+} imu_sample_t;
+
+unsigned int imu_stream_start(unsigned int int_pin, unsigned int rate_hz); // the rate it got, 0 if it couldn't
+int imu_stream_poll(void);              // FIFO into the ring, returns the samples moved
+bool imu_stream_get(imu_sample_t *s);   // oldest sample not taken yet
+int imu_stream_available(void);
+
+uint32_t imu_stream_overflows(void);    // times the FIFO filled up before we drained it
+uint32_t imu_stream_dropped(void);      // samples lost because the ring was full
+uint32_t imu_stream_interrupts(void);   // data ready pulses seen
+
+#endif
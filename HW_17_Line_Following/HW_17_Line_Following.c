@@ -1,11 +1,21 @@
 #include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/stdio_usb.h"
+#include "hardware/sync.h"
 #include "hardware/i2c.h"
 #include "ssd1306.h"
-#include "font.h"
+#include "ssd1306_widget.h"
 #include "hardware/adc.h"
 #include "cam.h"
 #include "motor.h"
+#include "control.h"
+#include "telemetry.h"
+#include "scheduler.h"
+#include "framelink.h"
+#include "camctl.h"
 
 // I2C defines
 #define I2C_PORT_OLED i2c0
@@ -15,11 +25,40 @@
 // Button Defines
 #define BUTTON_PIN 13 // GPIO pin for the button
 
-#define MOTOR_MIN 0
-#define MOTOR_MAX 0.75f // max PWM speed for motors
-
-float left_speed = 0;
-float right_speed = 0;
+// set to 1 to unpack the full colour image every frame and mark the line on it (for printImage)
+#define DEBUG_IMAGE 0
+
+// the controller runs at a fixed 100 Hz off a hardware alarm, faster than the camera so a new frame
+// is acted on within one period. Send 's' over USB for the timing statistics, 'r' to reset them
+#define CONTROL_PERIOD_US 10000
+
+// core 1 refreshes the OLED and the USB log this often, the control loop runs on core 0
+#define DISPLAY_PERIOD_MS 33
+
+// camera frames to the host in framelink packets (see framelink.h), one letter commands over USB:
+// 'c' one colour frame, 'b' one 1-bit frame, 'v' / 'm' stream colour / 1-bit, 'x' stop streaming
+// and print the link statistics, 'z' / 'u' compressed / uncompressed frames (colour as deltas
+// against the last frame sent, 1-bit as run lengths). Core 1 asks and does all the encoding,
+// core 0 only copies the next frame it gets before handing it back to the camera
+#define LINK_IDLE 0
+#define LINK_WANTED 1 // core 1 wants a frame
+#define LINK_FULL 2   // core 0 filled link_frame, core 1 owns it until it sets the state back
+#define LINK_KEYFRAME_EVERY 30 // raw colour frame this often, so a lost packet doesn't spoil the deltas for long
+static volatile int link_state = LINK_IDLE;
+static uint8_t link_frame[CAM_MAX_WIDTH * CAM_MAX_HEIGHT * 2]; // room for any size camera_set_size() allows
+static cameraFrame_t link_info;
+static int link_height;
+
+// exposure, gain and white balance (camctl.h): calibrated at boot and then locked so the line
+// threshold sees the same picture all run. 'e' calibrates again, 'k' keeps the loop running,
+// 'l' locks whatever it has now. Core 0 measures, core 1 writes the camera registers
+static camControl_t cam_ctl;
+
+// '+' / '-' switch the camera to the next bigger / smaller size (160x120, 80x60, 40x30). Core 1 calls
+// camera_set_size(), which waits for core 0 to release its frame, and core 0 sets the line rows
+// and capture band up again when the first frame at the new size comes in
+#define CAM_BIGGEST_SIZE OV7670_SIZE_DIV4
+#define CAM_SMALLEST_SIZE OV7670_SIZE_DIV16
 
 // debounce defines
 static bool last_button_state = false;
@@ -27,10 +66,13 @@ static int display_mode = 0;
 static absolute_time_t last_debounce_time;
 const uint64_t debounce_delay_us = 50000; // 50 ms in microseconds
 
-void drawmytext(int x, int y, char *m);
-void drawLetter(int x, int y, char c);
-void pixelBlink(int x, int y);
-void controller(float gain, int com);
+void core1_entry();
+static void link_grab(const cameraFrame_t *frame);
+static void link_send(uint8_t format, bool compress);
+static void link_report();
+
+static scheduler_t control_sched;
+static lineControl_t ctl; // line fit, PID and motor outputs, see control.c
 void check_button();
 
 
@@ -72,12 +114,23 @@ int main()
     bool last_button_state = false;
 
 
-    // the following functions are called to inialize the OLED display
-    ssd1306_setup();
-    ssd1306_clear();
-    ssd1306_update();
+    control_init(&ctl, getImageWidth(), getImageHeight(), CONTROL_PERIOD_US * 1e-6f);
+    setCaptureRows(LINE_FAR_ROW, ctl.nearRow - LINE_FAR_ROW + 1); // only bring in the rows we look at
+    startContinuousCapture(); // the camera keeps filling whichever buffer we are not using
+    cameraFrame_t frame = {0};
+
+    // OLED, LED and printf all live on core 1 so nothing below waits on I/O
+    multicore_launch_core1(core1_entry);
+
+    telemetry_t tel = {0};
+    uint64_t last_start = time_us_64();
+    scheduler_init(&control_sched, CONTROL_PERIOD_US);
 
     while (true) {
+        uint64_t wait_start = time_us_64();
+        scheduler_wait(&control_sched); // the only place the loop is allowed to block
+        uint64_t work_start = time_us_64();
+
         // Read button state
         //check_button();
 
@@ -86,146 +139,233 @@ int main()
         float voltage = (adc_value * 3.3f) / 4095.0f;
         float gain = 0.5f * voltage / 3.3f; // normalized gain (0 to 1)
 
-        // Process camera data
-        setSaveImage(1);
-        while (getSaveImage() == 1) {}
-        convertImage();
-        int com = findLine(IMAGESIZEY / 2); // center of line
-        setPixel(IMAGESIZEY / 2, com, 0, 255, 0);
-        printf("%d\r\n", com); // print COM for debugging maybe should take out
+        // Process camera data if a new frame came in, otherwise steer on the last one
+        bool new_frame = getFrame(&frame);
+        if (new_frame) {
+            if (frame.width != ctl.width || getImageHeight() != ctl.height) {
+                // core 1 changed the camera size, the size can't change again while we hold this frame
+                control_init(&ctl, frame.width, getImageHeight(), CONTROL_PERIOD_US * 1e-6f);
+                setCaptureRows(LINE_FAR_ROW, ctl.nearRow - LINE_FAR_ROW + 1); // from the next frame on
+            }
+            control_frame(&ctl, frame.data, frame.firstRow, frame.numRows);
+            camctl_measure(frame.data, frame.width, frame.numRows, frame.sequence, &tel.cam);
+            if (DEBUG_IMAGE) {
+                convertImage();
+                setPixel(ctl.height / 2 - frame.firstRow, ctl.com, 0, 255, 0); // the band sits at the top of the picture
+            }
+            link_grab(&frame); // only copies when the host asked for a frame
+            releaseFrame(); // done with the raw bytes, let the camera have the buffer back
+        }
 
         // Control motors based on COM and gain
+        control_step(&ctl, gain); // control motors based on gain and COM
+        uint64_t work_end = time_us_64();
+
+        // hand everything to core 1
+        tel.loops++;
+        tel.frame = frame.sequence;
+        tel.dropped = getDroppedFrames();
+        tel.adc = adc_value;
+        tel.com = ctl.com;
+        tel.gain = gain;
+        tel.left_speed = ctl.left_speed;
+        tel.right_speed = ctl.right_speed;
+        if (new_frame) {
+            tel.latency_us = (uint32_t)(work_end - frame.timestamp); // capture to actuation
+        }
+        tel.period_us = (uint32_t)(work_start - last_start);
+        tel.wait_us = (uint32_t)(work_start - wait_start);
+        tel.work_us = (uint32_t)(work_end - work_start);
+        if (tel.work_us > tel.work_max_us) tel.work_max_us = tel.work_us;
+        telemetry_publish(&tel);
+        last_start = work_start;
+    }
+}
 
-        controller(gain, com); // control motors based on gain and COM
-
-
-        // Draw to OLED based on display mode
-        ssd1306_clear();
-
-        // originally we were going to use this to display different modes but had an error where it only registered the button once.
-        // going to instead use it on a single display mode and put it on each row. 
-
-        // if (display_mode == 0) {
-        //     drawmytext(2, 2, "ADC Versus Gain");
-
-        //     char vbuf[30];
-        //     sprintf(vbuf, "V: %.2fV", voltage);
-        //     drawmytext(2, 12, vbuf);
-
-        //     char gbuf[30];
-        //     sprintf(gbuf, "Gain: %.2f", gain);
-        //     drawmytext(2, 22, gbuf);
-
-        // } else if (display_mode == 1) {
-        //     drawmytext(2, 2, "PWM Values");
-
-        //    char lbuf[30], rbuf[30];
-        //     sprintf(lbuf, "Left PWM: %.0f%%", left_speed * 100);
-        //     sprintf(rbuf, "Right PWM: %.0f%%", right_speed * 100);
-        //     drawmytext(2, 12, lbuf);
-        //     drawmytext(2, 22, rbuf);
-
-
-        // } else if (display_mode == 2) {
-        //     drawmytext(2, 2, "Line COM");
-
-        //     char combuf[30];
-        //     sprintf(combuf, "COM: %d", com);
-        //     drawmytext(2, 12, combuf);
-        // }
-
-        // Display Gain, PWM L/R, and COM in 3 rows
-        ssd1306_clear();
-
-        // Row 1 displays Gain
-        char buf1[30];
-        sprintf(buf1, "Gain: %.2f", gain);
-        drawmytext(2, 2, buf1); // Row 1
-
-        // Row 2 displays PWM for the left and right motors
-        char buf2[30];
-        sprintf(buf2, "PWM L:%.0f%% PWM R:%.0f%%", left_speed * 100, right_speed * 100);
-        drawmytext(2, 12, buf2); // Row 2
-
-        // Row 3 displays Center of Mass (COM)
-        char buf3[30];
-        sprintf(buf3, "COM: %d", com);
-        drawmytext(2, 22, buf3); // Row 3
+// core 1: everything slow. Reads the newest snapshot of the control loop and shows it
+void core1_entry() {
+    // the following functions are called to inialize the OLED display
+    ssd1306_setup();
+    ssd1306_clear();
 
-        ssd1306_update();
+    // Gain, PWM L/R and COM in 3 rows, the labels are drawn once and the numbers only when they change
+    ssd1306_field_t gain_field, left_field, right_field, com_field;
+    ssd1306_field_init(&gain_field, 2, 2, "Gain: ", 4, 2, NULL); // Row 1
+    ssd1306_field_init(&left_field, 2, 12, "PWM L:", 2, 0, "%"); // Row 2
+    ssd1306_field_init(&right_field, 2 + 10*SSD1306_FONT_ADVANCE, 12, "PWM R:", 2, 0, "%"); // after "PWM L:00% "
+    ssd1306_field_init(&com_field, 2, 22, "COM: ", 2, 0, NULL); // Row 3
+    ssd1306_update();
 
-        ssd1306_update();
+    telemetry_t t;
+    uint32_t last_loops = 0;
+    bool blink = false;
+    bool streaming = false;
+    uint8_t link_format = FRAMELINK_RGB565;
+    bool compress = false;
+    uint32_t last_cam_frame = 0;
 
-        // Blink LED to make sure communication is working
-        gpio_put(25, 1);
-        sleep_ms(10);
-        gpio_put(25, 0);
+    camctl_init(&cam_ctl); // the camera's I2C is only ours from here on, core 0 never touches it after init
+    camctl_calibrate(&cam_ctl);
 
-        // pixel blink to make sure OLED is working
-        pixelBlink(0, 0);
+    while (true) {
+        telemetry_read(&t);
+        if (t.loops != last_loops) {
+            // Display Gain, PWM L/R, and COM in 3 rows, fixed point so there's no float formatting here
+            ssd1306_field_set(&gain_field, (int32_t)(t.gain * 100.0f + 0.5f));
+            ssd1306_field_set(&left_field, (int32_t)(t.left_speed * 100.0f + 0.5f));
+            ssd1306_field_set(&right_field, (int32_t)(t.right_speed * 100.0f + 0.5f));
+            ssd1306_field_set(&com_field, t.com);
+
+            // blink the LED and a pixel to make sure both cores and the OLED are working
+            blink = !blink;
+            gpio_put(25, blink);
+            ssd1306_drawPixel(0, 0, blink);
+
+            ssd1306_update(); // returns right away, the DMA sends the screen while we keep going
+
+            if (t.cam.frame != last_cam_frame) {
+                camctl_update(&cam_ctl, &t.cam);
+                last_cam_frame = t.cam.frame;
+            }
 
-        printf("ADC Value: %d\n", adc_value);
-        printf("Voltage = %.2f V\n", voltage);
-        printf("Gain = %.2f\n", gain);
+            if (!streaming) { // the text log would only get in the way of the frame stream
+                printf("%d\r\n", t.com); // print COM for debugging maybe should take out
+                printf("frame %" PRIu32 " dropped %" PRIu32 " latency %" PRIu32 " us %.1f fps\r\n", t.frame, t.dropped, t.latency_us, getCaptureFps());
+                printf("loop %" PRIu32 " us wait %" PRIu32 " us work %" PRIu32 " us (max %" PRIu32 " us) loops %" PRIu32 "\r\n", t.period_us, t.wait_us, t.work_us, t.work_max_us, t.loops - last_loops);
+                printf("oled %u bytes\r\n", ssd1306_bytes_sent()); // only the text that changed goes out
+                printf("camera %s exposure %u gain %u/16 red %u blue %u, mean %u clipped %u%%\r\n", camctl_state_name(&cam_ctl),
+                       cam_ctl.exposure, cam_ctl.gain, cam_ctl.red, cam_ctl.blue, t.cam.mean, t.cam.clipped);
+                printf("ADC Value: %d\n", t.adc);
+                printf("Voltage = %.2f V\n", (t.adc * 3.3f) / 4095.0f);
+                printf("Gain = %.2f\n", t.gain);
+            }
+            last_loops = t.loops;
+        }
 
-        sleep_ms(100); // update ~100Hz
+        int c = getchar_timeout_us(0);
+        if (c != PICO_ERROR_TIMEOUT && !scheduler_command(&control_sched, "control", c)) { // 's' prints the control loop timing
+            if (c == 'c' || c == 'b' || c == 'v' || c == 'm') {
+                link_format = (c == 'c' || c == 'v') ? FRAMELINK_RGB565 : FRAMELINK_MONO;
+                streaming = (c == 'v' || c == 'm');
+                if (link_state == LINK_IDLE) link_state = LINK_WANTED;
+            } else if (c == 'x') {
+                streaming = false;
+                link_report();
+            } else if (c == 'z' || c == 'u') {
+                compress = (c == 'z');
+            } else if (c == 'e') {
+                camctl_calibrate(&cam_ctl);
+            } else if (c == 'k') {
+                camctl_track(&cam_ctl);
+            } else if (c == 'l') {
+                camctl_lock(&cam_ctl);
+            } else if (c == '+' || c == '-') {
+                int size = (int)camera_get_size() + (c == '+' ? -1 : 1); // smaller divider, bigger image
+                if (size >= CAM_BIGGEST_SIZE && size <= CAM_SMALLEST_SIZE && camera_set_size((OV7670_size)size)) {
+                    printf("camera %dx%d\r\n", getImageWidth(), getImageHeight());
+                } else {
+                    printf("camera stays %dx%d\r\n", getImageWidth(), getImageHeight());
+                }
+            }
+        }
+        if (link_state == LINK_FULL) {
+            __dmb(); // see the frame core 0 copied, not what was there before
+            link_send(link_format, compress);
+            link_state = streaming ? LINK_WANTED : LINK_IDLE;
+        }
+        sleep_ms(DISPLAY_PERIOD_MS);
     }
 }
 
-// function to draw text on OLED display
-void drawmytext(int x, int y, char *m) { // draws a string on the OLED display
-    int i = 0;
-    int startX = x;
-    while (m[i] != '\0') { // loop through each character in the string
-        if (x + 5 >= 128) {// if we reach the end of the display, wrap to next line 
-            x = startX;
-            y += 8;
-            if (y + 8 > 64) break; // for 64px tall display
-        }
-        drawLetter(x, y, m[i]); //draw the letter using our function
-        x += 6;
-        i++;
+// core 0: copy the frame for the host if core 1 asked for one, a few us for the 50 row band
+static void link_grab(const cameraFrame_t *frame) {
+    if (link_state != LINK_WANTED) {
+        return;
     }
+    uint32_t bytes = framelink_size(FRAMELINK_RGB565, frame->width, frame->numRows);
+    if (bytes > sizeof(link_frame)) {
+        return; // can't happen with the sizes '+' allows, but never copy past the buffer
+    }
+    memcpy(link_frame, (const uint8_t *)frame->data, bytes);
+    link_info = *frame;
+    link_info.data = link_frame;
+    link_height = getImageHeight();
+    __dmb(); // the copy has to land before core 1 sees LINK_FULL
+    link_state = LINK_FULL;
 }
 
-void drawLetter(int x, int y, char c) { //draw a single character on the OLED display using the font array
-    int index = c - 0x20; // ASCII offset for space character
-    if (index < 0 || index >= 96) return;
-
-    for (int i = 0; i < 5; i++) { // loop through each column of the character
-        char col = ASCII[index][i];
-        for (int j = 0; j < 8; j++) { // loop through each row of the character
-            char on = (col >> j) & 0b1; // check if pixel is on (1) or off (0)
-            ssd1306_drawPixel(x + i, y + j, on); // draw the pixel on the OLED display
+// what the encoder is doing, 'x' prints it
+static uint32_t link_frames = 0;
+static uint64_t link_raw_bytes = 0;   // what the frames would have been uncompressed
+static uint64_t link_sent_bytes = 0;
+static uint64_t link_encode_us = 0;
+static uint32_t link_encode_max_us = 0;
+
+// core 1: encode the frame core 0 left in link_frame and write it to USB
+static void link_send(uint8_t format, bool compress) {
+    static uint8_t payload[CAM_MAX_WIDTH * CAM_MAX_HEIGHT * 2 + CAM_MAX_WIDTH * CAM_MAX_HEIGHT / 64 + 1];
+    static uint8_t prev[CAM_MAX_WIDTH * CAM_MAX_HEIGHT * 2]; // last colour frame sent, what the deltas are against
+    static bool prev_valid = false;
+    static cameraFrame_t prev_info;
+    static uint32_t since_key = 0;
+
+    int pixels = link_info.width * link_info.numRows;
+    uint32_t raw = framelink_size(FRAMELINK_RGB565, link_info.width, link_info.numRows);
+    uint32_t size = 0;
+    uint16_t reference = 0;
+    uint32_t start = time_us_32();
+    if (format == FRAMELINK_MONO) {
+        format = compress ? FRAMELINK_MONO_RLE : FRAMELINK_MONO;
+        size = compress ? framelink_encode_rle(payload, link_frame, link_info.width, link_info.numRows)
+                        : framelink_pack_mono(payload, link_frame, link_info.width, link_info.numRows);
+    } else {
+        bool same_band = prev_valid && prev_info.numRows == link_info.numRows && prev_info.firstRow == link_info.firstRow
+                         && prev_info.width == link_info.width;
+        if (compress && same_band && since_key < LINK_KEYFRAME_EVERY) {
+            size = framelink_encode_delta(payload, raw, link_frame, prev, pixels); // 0 if it isn't smaller
+        }
+        if (size > 0) {
+            format = FRAMELINK_RGB565_DELTA;
+            reference = (uint16_t)prev_info.sequence;
+            since_key++;
+        } else {
+            memcpy(payload, link_frame, raw);
+            size = raw;
+            since_key = 0;
         }
+        memcpy(prev, link_frame, raw);
+        prev_info = link_info;
+        prev_valid = true;
     }
+    uint32_t encode_us = time_us_32() - start;
+
+    framelinkHeader_t h;
+    framelink_header(&h, format, link_info.width, link_height, link_info.firstRow, link_info.numRows,
+                     reference, link_info.sequence, link_info.timestamp, payload, size);
+    // straight to the USB driver, printf would turn every 0x0A byte into \r\n
+    stdio_usb.out_chars((const char *)&h, sizeof(h));
+    stdio_usb.out_chars((const char *)payload, (int)size);
+
+    link_frames++;
+    bool mono = (format == FRAMELINK_MONO || format == FRAMELINK_MONO_RLE);
+    link_raw_bytes += sizeof(h) + (mono ? framelink_size(FRAMELINK_MONO, link_info.width, link_info.numRows) : raw);
+    link_sent_bytes += sizeof(h) + size;
+    link_encode_us += encode_us;
+    if (encode_us > link_encode_max_us) link_encode_max_us = encode_us;
 }
 
-void pixelBlink(int x, int y) { // function to blink a pixel on the OLED display for visual feedback
-    ssd1306_drawPixel(x, y, 1);
-    ssd1306_update();
-    sleep_ms(10);
-    ssd1306_drawPixel(x, y, 0);
-    ssd1306_update();
-}
-
-
-void controller(float gain, int com) {
-        //compute error
-        int setpoint = IMAGESIZEX / 2;  // center of image
-        int error = setpoint - com;     // how far off the line center we are
-
-        float turn_adjust = gain * (float)error; // adjust turn based on gain and error
-        float base_speed = 0.6f; // base speed for motors 60% PWM
-        left_speed = base_speed + turn_adjust;  // adjust left motor speed
-        right_speed = base_speed - turn_adjust; // adjust right motor speed
-        // Clamp speeds between a preset min and max
-        if (left_speed < MOTOR_MIN) left_speed = MOTOR_MIN;
-        if (left_speed > MOTOR_MAX) left_speed = MOTOR_MAX;
-        if (right_speed < MOTOR_MIN) right_speed = MOTOR_MIN;
-        if (right_speed > MOTOR_MAX) right_speed = MOTOR_MAX;
-        motor_set_speed(IN1_PIN, left_speed);   // left motor
-        motor_set_speed(IN2_PIN, right_speed);  // right motor
+static void link_report() {
+    if (link_frames == 0) {
+        return;
+    }
+    printf("link: %" PRIu32 " frames, %" PRIu64 " bytes for %" PRIu64 " (ratio %.2f), encode %" PRIu64 " us mean %" PRIu32 " us max\r\n",
+           link_frames, link_sent_bytes, link_raw_bytes, (float)link_raw_bytes / (float)link_sent_bytes,
+           link_encode_us / link_frames, link_encode_max_us);
+    link_frames = 0;
+    link_raw_bytes = 0;
+    link_sent_bytes = 0;
+    link_encode_us = 0;
+    link_encode_max_us = 0;
 }
 
 // this function checks the button state and handles debouncing
@@ -1,59 +1,207 @@
+#include <stdlib.h> // for malloc
+#include <inttypes.h> // PRIu32, uint32_t is unsigned long on the pico and unsigned int on a PC
 #include "cam.h"
+#include "line.h"
+
+// PIO + DMA capture state
+static PIO cam_pio = pio0;
+static uint cam_sm = 0;
+static uint cam_offset = 0;
+static int cam_dma_chan = -1;
+static void (*captureCallback)(void) = NULL;
+// the buffer bookkeeping is shared by the DMA interrupt and getFrame()/releaseFrame() on core 0
+// and camera_set_size() on core 1, a hardware spin lock keeps both cores out of it at once
+static spin_lock_t *camLock = NULL;
+
+// window settings for each size, tediously determined empirically.
+// I hope there's a formula for this, if a do-over is needed.
+typedef struct cameraSize{
+    uint16_t width;
+    uint16_t height;
+    uint16_t vstart;
+    uint16_t hstart;
+    uint16_t edge_offset;
+    uint16_t pclk_delay;
+} cameraSize_t;
+
+static const cameraSize_t cameraSizes[] = {
+    {640, 480,  9, 162, 2, 2}, // SIZE_DIV1  640x480 VGA
+    {320, 240, 10, 174, 4, 2}, // SIZE_DIV2  320x240 QVGA
+    {160, 120, 11, 186, 2, 2}, // SIZE_DIV4  160x120 QQVGA
+    { 80,  60, 12, 210, 0, 2}, // SIZE_DIV8  80x60   ...
+    { 40,  30, 15, 252, 3, 2}, // SIZE_DIV16 40x30
+};
+
+// every buffer comes out of one allocation sized for the current resolution:
+// CAM_NUM_BUFFERS raw frames (2 bytes per pixel) followed by the r, g and b planes
+static uint8_t *frameMemory = NULL;
+static volatile uint8_t *cameraData[CAM_NUM_BUFFERS];
+static volatile struct cameraImage picture;
+static OV7670_size imageSize = IMAGESIZE;
+static volatile int imageWidth = IMAGESIZEX;
+static volatile int imageHeight = IMAGESIZEY;
+
+// region of interest, only these rows are moved into the buffer (packed at the start of it)
+static volatile int roiFirstRow = 0;
+static volatile int roiNumRows = IMAGESIZEY;
+static volatile uint32_t captureWords = IMAGESIZEX*IMAGESIZEY*2/4; // 4 bytes are packed per word by the PIO
+static volatile int bufferFirstRow[CAM_NUM_BUFFERS];
+static volatile int bufferNumRows[CAM_NUM_BUFFERS];
+static volatile uint64_t lastFrameTime = 0;
+static volatile float framePeriodUs = 0; // smoothed time between finished frames
+
+// ping-pong buffer bookkeeping, -1 means no buffer
+static volatile bool continuousCapture = false;
+static volatile int captureBuf = -1; // buffer the DMA is filling
+static volatile int readyBuf = -1;   // newest finished frame nobody has taken yet
+static volatile int heldBuf = -1;    // buffer the control loop is working on
+static volatile uint32_t frameSequence = 0;
+static volatile uint32_t droppedFrames = 0;
+static volatile uint64_t bufferTimestamp[CAM_NUM_BUFFERS];
+static volatile uint32_t bufferSequence[CAM_NUM_BUFFERS];
+static const volatile uint8_t *currentFrame = NULL; // what convertImage() reads
+static volatile bool resizing = false; // camera_set_size() is swapping the buffers, getFrame() hands nothing out
+
+static void start_camera_capture(int buf);
+static void OV7670_set_size(OV7670_size size);
+
+// DMA finished the frame, the whole image is in cameraData[captureBuf]
+static void cam_dma_handler(){
+    if (!dma_channel_get_irq0_status(cam_dma_chan)){
+        return; // the interrupt is shared, it was not for us
+    }
+    dma_channel_acknowledge_irq0(cam_dma_chan);
 
-void gpio_callback(uint gpio, uint32_t events) {
-    if (gpio == VS){
-        //printf("v\n");
-        if (saveImage==1){
-            //printf("v\n");
-            rawIndex = 0;
-            hsCount = 0;
-            vsCount = 0;
-            startImage = 1;
-            startCollect = 0;
-        }
+    uint32_t irq = spin_lock_blocking(camLock);
+    int done = captureBuf;
+    if (done < 0){
+        spin_unlock(camLock, irq); // stopped from the other core as the frame finished
+        return;
     }
-    if (gpio == HS){
-        //printf("h");
-        if(saveImage){
-            if (startImage){
-                startCollect = 1;
-                hsCount++;
-                if (hsCount == IMAGESIZEY){
-                    //printf("%d",hsCount);
-                    saveImage = 0;
-                    startImage = 0;
-                    startCollect = 0;
-                    hsCount = 0;
-                }
-            }
-        }
+    uint64_t now = time_us_64();
+    bufferTimestamp[done] = now;
+    bufferSequence[done] = frameSequence++;
+    if (lastFrameTime != 0){
+        float period = (float)(now - lastFrameTime);
+        framePeriodUs = (framePeriodUs == 0) ? period : 0.9f*framePeriodUs + 0.1f*period;
     }
-    if (gpio == PCLK){
-        if(saveImage){
-            if(startImage){
-                if(startCollect){
-                    vsCount++;
-                    // read the raw data
-                    uint32_t d = gpio_get_all();
-                    cameraData[rawIndex] = d & 0xFF;
-                    rawIndex++;
-                    if (rawIndex == IMAGESIZEX*IMAGESIZEY*2){
-                        saveImage = 0;
-                        startImage = 0;
-                        startCollect = 0;
-                    }
-                    if (vsCount == IMAGESIZEX*2){
-                        startCollect = 0;
-                        vsCount = 0;
-                    }
-                }
-            }
+    lastFrameTime = now;
+
+    if (continuousCapture && !resizing){
+        if (readyBuf >= 0){
+            droppedFrames++; // the control loop never picked up the last one
         }
+        readyBuf = done;
+        // keep going in the other buffer unless the control loop still has it
+        int next = 1 - done;
+        if (next != heldBuf){
+            start_camera_capture(next);
+        }
+        else {
+            captureBuf = -1; // stalled until releaseFrame()
+        }
+    }
+    else {
+        currentFrame = cameraData[done];
+        captureBuf = -1;
+        saveImage = 0;
+    }
+    spin_unlock(camLock, irq);
+
+    if (captureCallback != NULL){
+        captureCallback();
+    }
+}
+
+// (re)allocate the raw frames and colour planes for a size, keeps the old buffers if there is no room
+static bool alloc_frame_buffers(int width, int height){
+    size_t frameBytes = (size_t)width*height*2;
+    size_t planeBytes = (size_t)width*height;
+    uint8_t *mem = malloc(CAM_NUM_BUFFERS*frameBytes + 3*planeBytes);
+    if (mem == NULL){
+        return false;
+    }
+    free(frameMemory);
+    frameMemory = mem; // malloc is 8 byte aligned and rows are a multiple of 4 bytes, so DMA can write words
+
+    int i;
+    for(i=0;i<CAM_NUM_BUFFERS;i++){
+        cameraData[i] = mem + i*frameBytes;
+    }
+    uint8_t *planes = mem + CAM_NUM_BUFFERS*frameBytes;
+    picture.r = planes;
+    picture.g = planes + planeBytes;
+    picture.b = planes + 2*planeBytes;
+    currentFrame = cameraData[0];
+
+    imageWidth = width;
+    imageHeight = height;
+    roiFirstRow = 0;
+    roiNumRows = height;
+    captureWords = width*height*2/4;
+    return true;
+}
+
+// load the capture program and claim a DMA channel that drains the RX fifo into cameraData
+static void init_camera_capture(){
+    if (frameMemory == NULL){
+        alloc_frame_buffers(cameraSizes[imageSize].width, cameraSizes[imageSize].height);
     }
+    camLock = spin_lock_init(spin_lock_claim_unused(true));
+
+    cam_offset = pio_add_program(cam_pio, &cam_capture_program);
+    cam_sm = pio_claim_unused_sm(cam_pio, true);
+    cam_capture_program_init(cam_pio, cam_sm, cam_offset, D0);
+
+    cam_dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(cam_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false); // always read the fifo
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(cam_pio, cam_sm, false)); // paced by the RX fifo
+    dma_channel_configure(cam_dma_chan, &c, cameraData[0], &cam_pio->rxf[cam_sm], captureWords, false);
+
+    dma_channel_set_irq0_enabled(cam_dma_chan, true);
+    irq_add_shared_handler(DMA_IRQ_0, cam_dma_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+
+// stop the state machine and DMA, throws away a partial frame
+static void stop_camera_capture(){
+    pio_sm_set_enabled(cam_pio, cam_sm, false);
+    dma_channel_abort(cam_dma_chan);
+    dma_channel_acknowledge_irq0(cam_dma_chan); // abort can leave the irq flag set
+    captureBuf = -1;
+}
+
+// restart the state machine from the top and let it wait for the next VS
+static void start_camera_capture(int buf){
+    captureBuf = buf;
+    bufferFirstRow[buf] = roiFirstRow;
+    bufferNumRows[buf] = roiNumRows;
+    pio_sm_set_enabled(cam_pio, cam_sm, false);
+    pio_sm_clear_fifos(cam_pio, cam_sm);
+    pio_sm_restart(cam_pio, cam_sm);
+    pio_sm_exec(cam_pio, cam_sm, pio_encode_jmp(cam_offset));
+    dma_channel_set_write_addr(cam_dma_chan, cameraData[buf], false);
+    dma_channel_set_trans_count(cam_dma_chan, captureWords, true);
+    pio_sm_put(cam_pio, cam_sm, roiFirstRow); // rows to skip
+    pio_sm_put(cam_pio, cam_sm, roiNumRows - 1); // rows
+    pio_sm_put(cam_pio, cam_sm, imageWidth*2 - 1); // bytes per row
+    pio_sm_set_enabled(cam_pio, cam_sm, true);
 }
 
+// delays from the OV7670 datasheet power up and reset timing, everything else can go back to back
+#define OV7670_POWERUP_MS 3 // MCLK running and PWDN low before the first SCCB access
+#define OV7670_RESET_MS 1   // registers settle after a hardware or software reset
+
+static uint8_t regShadow[256]; // last value written to each register, for the readback check
+static uint32_t initTimeUs = 0;
+
 // setup the camera pins
 void init_camera_pins(){
+    uint64_t t0 = time_us_64();
+
     // 8 data pins
     gpio_init(D0);
     gpio_set_dir(D0, GPIO_IN);
@@ -90,13 +238,13 @@ void init_camera_pins(){
     pwm_set_enabled(slice_num, true); // turn on the PWM
     pwm_set_gpio_level(MCLK, wrap / 2); // set the duty cycle to 50%
 
-    sleep_ms(1000); // give the camera time to get going
+    sleep_ms(OV7670_POWERUP_MS); // give the camera time to get going
 
     // powerdown and restart
     gpio_put(PWDN, 1);
     sleep_ms(1);
     gpio_put(PWDN, 0);
-    sleep_ms(1000);
+    sleep_ms(OV7670_POWERUP_MS);
 
     // I2C Initialisation. Using it at 100Khz.
     i2c_init(I2C_PORT, 100*1000);
@@ -107,23 +255,18 @@ void init_camera_pins(){
     
     printf("Start init camera\n");
     init_camera();
-    printf("End init camera\n");
+    initTimeUs = (uint32_t)(time_us_64() - t0);
+    printf("End init camera, took %" PRIu32 " ms\n", initTimeUs / 1000);
 
-    // interrupts
+    // sync and pixel clock pins, sampled by the PIO
     gpio_init(VS); // vertical sync
     gpio_set_dir(VS, GPIO_IN);
-    // new image starts on falling VS
-    gpio_set_irq_enabled_with_callback(VS, GPIO_IRQ_EDGE_FALL, true, &gpio_callback);
-
     gpio_init(HS); // horizontal sync
     gpio_set_dir(HS, GPIO_IN);
-    // new row starts on rising HS
-    gpio_set_irq_enabled_with_callback(HS, GPIO_IRQ_EDGE_RISE, true, &gpio_callback);
-
     gpio_init(PCLK); // pixel clock
     gpio_set_dir(PCLK, GPIO_IN);
-    // read byte on rising PCLK
-    gpio_set_irq_enabled_with_callback(PCLK, GPIO_IRQ_EDGE_RISE, true, &gpio_callback);
+
+    init_camera_capture();
 }
 
 // init the camera with RST and I2C commands
@@ -132,45 +275,84 @@ void init_camera(){
     gpio_put(RST, 0);
     sleep_ms(1);
     gpio_put(RST, 1);
-    sleep_ms(1000);
+    sleep_ms(OV7670_RESET_MS);
 
-    OV7670_write_register(0x12, 0x80); // software reset
-    sleep_ms(1000);
+    OV7670_write_register(OV7670_REG_COM7, OV7670_COM7_RESET); // software reset
+    sleep_ms(OV7670_RESET_MS);
 
     // perform all the I2C writes for init
     // 25MHz * PLL / divisor = 24MHz for 30fps -> actually only 5fps
     OV7670_write_register(OV7670_REG_CLKRC, 1); // div 1
     OV7670_write_register(OV7670_REG_DBLV, 0); // no pll
 
-    int i = 0;
-
     // init regular registers
-    for(i=0; i<92; i++){
-        OV7670_write_register(OV7670_init[i][0],OV7670_init[i][1]);
-    }
+    OV7670_write_table(OV7670_init);
 
     // set colorspace to RGB565
-    for(i=0; i<12; i++){
-        OV7670_write_register(OV7670_rgb[i][0],OV7670_rgb[i][1]);
-    }
+    OV7670_write_table(OV7670_rgb);
 
     // init image size
-    
-    // Window settings were tediously determined empirically.
-    // I hope there's a formula for this, if a do-over is needed.
-    //{vstart,hstart,edge_offset,pclk_delay}
-            //{9, 162, 2, 2},  // SIZE_DIV1  640x480 VGA
-            //{10, 174, 4, 2}, // SIZE_DIV2  320x240 QVGA
-            //{11, 186, 2, 2}, // SIZE_DIV4  160x120 QQVGA
-            //{12, 210, 0, 2}, // SIZE_DIV8  80x60   ...
-            //{15, 252, 3, 2}, // SIZE_DIV16 40x30
+    OV7670_set_size(imageSize);
+
+    //OV7670_test_pattern(OV7670_TEST_PATTERN_NONE);
+    //OV7670_test_pattern(OV7670_TEST_PATTERN_COLOR_BAR);
+
+    uint8_t p = OV7670_read_register(OV7670_REG_PID);
+    printf("pid = %d (118)\n",p);
+
+    uint8_t v = OV7670_read_register(OV7670_REG_VER);
+    printf("ver = %d (115)\n",v);
+
+    int bad = OV7670_verify_registers();
+    if (bad){
+        printf("%d camera registers did not read back\n", bad);
+    }
+}
+
+// write a {register, value} table, stops at the {0xff, 0xff} end marker
+int OV7670_write_table(const uint8_t table[][2]){
+    int i = 0;
+    while (!(table[i][0] == 0xff && table[i][1] == 0xff)){
+        OV7670_write_register(table[i][0], table[i][1]);
+        i++;
+    }
+    return i;
+}
+
+// registers the picture can't work without, read back after init
+static const uint8_t criticalRegs[] = {
+    OV7670_REG_CLKRC, OV7670_REG_DBLV, OV7670_REG_COM7, OV7670_REG_COM15, OV7670_REG_RGB444,
+    OV7670_REG_COM3, OV7670_REG_COM14, OV7670_REG_SCALING_DCWCTR, OV7670_REG_SCALING_PCLK_DIV,
+    OV7670_REG_HSTART, OV7670_REG_HSTOP, OV7670_REG_VSTART, OV7670_REG_VSTOP,
+};
 
+// read back the critical registers, returns how many don't match what we wrote
+int OV7670_verify_registers(){
+    int bad = 0;
+    int i;
+    for(i=0; i<(int)sizeof(criticalRegs); i++){
+        uint8_t reg = criticalRegs[i];
+        uint8_t value = OV7670_read_register(reg);
+        if (value != regShadow[reg]){
+            printf("reg 0x%02X = 0x%02X, wrote 0x%02X\n", reg, value, regShadow[reg]);
+            bad++;
+        }
+    }
+    return bad;
+}
+
+// how long init_camera_pins() took, power up to ready
+uint32_t getCameraInitTime(){
+    return initTimeUs;
+}
+
+// program the downsampling and window registers for one of the sizes in cameraSizes
+static void OV7670_set_size(OV7670_size size){
     uint8_t value;
-    uint8_t size = OV7670_SIZE_DIV8; // 80x60
-    uint16_t vstart = 12;
-    uint16_t hstart = 210;
-    uint16_t edge_offset = 0;
-    uint16_t pclk_delay = 2;
+    uint16_t vstart = cameraSizes[size].vstart;
+    uint16_t hstart = cameraSizes[size].hstart;
+    uint16_t edge_offset = cameraSizes[size].edge_offset;
+    uint16_t pclk_delay = cameraSizes[size].pclk_delay;
 
     // Enable downsampling if sub-VGA, and zoom if 1:16 scale
     value = (size > OV7670_SIZE_DIV1) ? OV7670_COM3_DCWEN : 0;
@@ -216,18 +398,73 @@ void init_camera(){
     OV7670_write_register(OV7670_REG_VSTOP, vstop >> 2);
     OV7670_write_register(OV7670_REG_VREF, ((vstop & 0b11) << 2) | (vstart & 0b11));
     OV7670_write_register(OV7670_REG_SCALING_PCLK_DELAY, pclk_delay);
+}
 
-    sleep_ms(300); // allow camera to settle with new settings 
+// switch resolution without a reboot: stops the capture, waits for the control loop to hand back the
+// frame it is working on, resizes the buffers, reprograms the window and picks the capture back up.
+// Call it from core 1 (it does the SCCB writes, and the core holding a frame would wait on itself).
+// Returns false and changes nothing if the frame isn't released within CAM_RESIZE_TIMEOUT_US or the
+// buffers do not fit in RAM, 160x120 needs about 135KB, QVGA and VGA are too big for the pico 2.
+// Frames taken afterwards carry the new width, the height is getImageHeight()
+bool camera_set_size(OV7670_size size){
+    if (size > OV7670_SIZE_DIV16){
+        return false;
+    }
+    if (cam_dma_chan < 0){
+        // not capturing yet, nobody can be holding a buffer
+        if (!alloc_frame_buffers(cameraSizes[size].width, cameraSizes[size].height)){
+            return false;
+        }
+        imageSize = size;
+        return true;
+    }
 
-    //OV7670_test_pattern(OV7670_TEST_PATTERN_NONE);
-    //OV7670_test_pattern(OV7670_TEST_PATTERN_COLOR_BAR);
-    //sleep_ms(300);
+    uint32_t irq = spin_lock_blocking(camLock);
+    bool wasRunning = continuousCapture;
+    resizing = true; // from here getFrame() returns nothing and releaseFrame() doesn't restart the capture
+    continuousCapture = false;
+    stop_camera_capture();
+    readyBuf = -1;
+    saveImage = 0;
+    spin_unlock(camLock, irq);
+
+    // the control loop may still be reading a buffer, they can't be freed until it calls releaseFrame()
+    uint64_t start = time_us_64();
+    bool released = true;
+    while (heldBuf >= 0){
+        if (time_us_64() - start > CAM_RESIZE_TIMEOUT_US){
+            released = false;
+            break;
+        }
+        tight_loop_contents();
+    }
 
-    uint8_t p = OV7670_read_register(OV7670_REG_PID);
-    printf("pid = %d (118)\n",p);
+    bool ok = released && alloc_frame_buffers(cameraSizes[size].width, cameraSizes[size].height);
+    if (ok){
+        imageSize = size;
+        OV7670_set_size(size);
+    }
+    irq = spin_lock_blocking(camLock);
+    if (wasRunning){
+        // after a timeout the control loop still has its buffer, fill the other one
+        continuousCapture = true;
+        start_camera_capture(heldBuf == 0 ? 1 : 0);
+    }
+    resizing = false;
+    spin_unlock(camLock, irq);
+    return ok;
+}
 
-    uint8_t v = OV7670_read_register(OV7670_REG_VER);
-    printf("ver = %d (115)\n",v);
+OV7670_size camera_get_size(){
+    return imageSize;
+}
+
+int getImageWidth(){
+    return imageWidth;
+}
+
+int getImageHeight(){
+    return imageHeight;
 }
 
 // Selects one of the camera's test patterns (or disable).
@@ -258,7 +495,7 @@ void OV7670_write_register(uint8_t reg, uint8_t value){
     buf[0] = reg;
     buf[1] = value;
     i2c_write_blocking(I2C_PORT, OV7670_ADDR, buf, 2, false);
-    sleep_ms(1); // after each
+    regShadow[reg] = value;
 }
 
 // I2C read from the camera
@@ -269,9 +506,126 @@ uint8_t OV7670_read_register(uint8_t reg){
     return buf;
 }
 
-// save an image
+// save an image, 1 starts a single capture and 0 aborts one in progress
 void setSaveImage(uint32_t s){
+    if (cam_dma_chan < 0){
+        return; // capture not set up yet
+    }
+    stopContinuousCapture();
     saveImage = s;
+    if (s){
+        start_camera_capture(0);
+    }
+}
+
+// keep capturing, alternating between the two buffers
+void startContinuousCapture(){
+    if (cam_dma_chan < 0){
+        return;
+    }
+    stop_camera_capture();
+    saveImage = 0;
+    readyBuf = -1;
+    heldBuf = -1;
+    continuousCapture = true;
+    start_camera_capture(0);
+}
+
+void stopContinuousCapture(){
+    if (cam_dma_chan < 0){
+        return;
+    }
+    continuousCapture = false;
+    stop_camera_capture();
+    readyBuf = -1;
+    heldBuf = -1;
+}
+
+// take the newest finished frame if there is one, returns false if nothing new arrived.
+// The frame stays valid until releaseFrame() or the next getFrame()
+bool getFrame(cameraFrame_t *frame){
+    if (cam_dma_chan < 0){
+        return false;
+    }
+    uint32_t irq = spin_lock_blocking(camLock);
+    if (readyBuf < 0 || resizing){
+        spin_unlock(camLock, irq);
+        return false;
+    }
+    int take = readyBuf;
+    readyBuf = -1;
+    int old = heldBuf;
+    heldBuf = take;
+    if (old >= 0 && captureBuf < 0 && continuousCapture){
+        start_camera_capture(old); // capture was waiting on the buffer we just gave back
+    }
+    spin_unlock(camLock, irq);
+
+    frame->data = cameraData[take];
+    frame->sequence = bufferSequence[take];
+    frame->timestamp = bufferTimestamp[take];
+    frame->firstRow = bufferFirstRow[take];
+    frame->numRows = bufferNumRows[take];
+    frame->width = imageWidth;
+    currentFrame = frame->data;
+    return true;
+}
+
+// block until a new frame is ready
+void waitFrame(cameraFrame_t *frame){
+    while (!getFrame(frame)){
+        tight_loop_contents();
+    }
+}
+
+// hand the frame back so the camera can fill it again
+void releaseFrame(){
+    if (cam_dma_chan < 0){
+        return;
+    }
+    uint32_t irq = spin_lock_blocking(camLock);
+    int old = heldBuf;
+    heldBuf = -1;
+    if (old >= 0 && captureBuf < 0 && continuousCapture){
+        start_camera_capture(old);
+    }
+    spin_unlock(camLock, irq);
+}
+
+// only capture numRows rows starting at firstRow, takes effect from the next frame.
+// setCaptureRows(0, getImageHeight()) goes back to the whole image, so does camera_set_size()
+void setCaptureRows(int firstRow, int numRows){
+    if (cam_dma_chan < 0){
+        return; // init_camera_pins() starts with the whole image
+    }
+    if (firstRow < 0) firstRow = 0;
+    if (firstRow > imageHeight - 1) firstRow = imageHeight - 1;
+    if (numRows < 1) numRows = 1;
+    if (firstRow + numRows > imageHeight) numRows = imageHeight - firstRow;
+
+    uint32_t irq = spin_lock_blocking(camLock);
+    roiFirstRow = firstRow;
+    roiNumRows = numRows;
+    captureWords = numRows*imageWidth*2/4; // rows are a multiple of 4 bytes at every size
+    spin_unlock(camLock, irq);
+}
+
+// frames per second the camera is actually delivering
+float getCaptureFps(){
+    if (framePeriodUs == 0){
+        return 0;
+    }
+    return 1000000.0f / framePeriodUs;
+}
+
+// total frames the camera has finished since boot
+uint32_t getFrameCount(){
+    return frameSequence;
+}
+
+// frames that were overwritten before getFrame() picked them up
+uint32_t getDroppedFrames(){
+    return droppedFrames;
 }
 
 // see if you are supposed to be saving an image
@@ -279,76 +633,48 @@ uint32_t getSaveImage(){
     return saveImage;
 }
 
-// how many rows were counted, should be IMAGESIZEY
+// called from the DMA interrupt as soon as a frame is finished
+void setCaptureCallback(void (*callback)(void)){
+    captureCallback = callback;
+}
+
+// how many rows were counted, should be the image height (or the region of interest)
 uint32_t getHSCount(){
-    return hsCount;
+    return getPixelCount() / (imageWidth*2);
 }
 
-// how many pixels were counted times 2, should be 2*IMAGESIZEX*IMAGESIZEY
+// how many pixels were counted times 2, should be 2*width*height
 uint32_t getPixelCount(){
-    return rawIndex;
+    if (cam_dma_chan < 0){
+        return 0;
+    }
+    return (captureWords - dma_channel_hw_addr(cam_dma_chan)->transfer_count) * 4;
 }
 
-// convert the raw image to RGB
+// convert the raw image to RGB, uses the frame from getFrame() or the last setSaveImage() capture.
+// with a region of interest the captured rows are at the top of the picture
 // https://blog.usedbytes.com/2022/02/pico-pio-camera/
 void convertImage(){
     picture.index = 0;
     int i = 0;
-    for(i=0;i<IMAGESIZEX*IMAGESIZEY*2;i=i+2){
+    for(i=0;i<imageWidth*imageHeight*2;i=i+2){
         
-        picture.r[picture.index] = (cameraData[i+1]>>3)<<3;
-        picture.g[picture.index] = (((cameraData[i+1]&0b111)<<3) | cameraData[i]>>5)<<2;
-        picture.b[picture.index] = (cameraData[i]&0b11111)<<3;
+        picture.r[picture.index] = (currentFrame[i+1]>>3)<<3;
+        picture.g[picture.index] = (((currentFrame[i+1]&0b111)<<3) | currentFrame[i]>>5)<<2;
+        picture.b[picture.index] = (currentFrame[i]&0b11111)<<3;
         picture.index++;
     }
 }
 
-// threshold and then find the center of mass of a row
+// threshold and then find the center of mass of a row. Works on the raw frame (see line.c),
+// the picture planes are left alone so printImage() still shows what the camera saw
 int findLine(int row){
-    int pos = 0;
-    int r = row*IMAGESIZEX; // find the index of the start of the row in the pixel array
-    int sumMass = 0;
-    int sumMassR = 0;
-
-    int i;
-
-    // find the row average brightness
-    int sumBright = 0;
-    for(i=0;i<IMAGESIZEX;i++){
-        sumBright = sumBright + picture.r[r+i] + picture.g[r+i] + picture.b[r+i];
-    }
-    int avgBright = sumBright / IMAGESIZEX;
-
-    // threshold the row
-    for(i=0;i<IMAGESIZEX;i++){
-        int mass = picture.r[r+i] + picture.g[r+i] + picture.b[r+i];
-        if (mass < avgBright){
-            // not bright enough, set pixel to black
-            picture.r[r+i] = 0;
-            picture.g[r+i] = 0;
-            picture.b[r+i] = 0;
-        }
-        else {
-            // set to white
-            picture.r[r+i] = 255;
-            picture.g[r+i] = 255;
-            picture.b[r+i] = 255;
-        }
-    }
-
-    // calculate the center of mass of the thresholded row
-    for(i=0;i<IMAGESIZEX;i++){
-        int mass = picture.r[r+i] + picture.g[r+i] + picture.b[r+i];
-        sumMass = sumMass + mass;
-        sumMassR = sumMassR + mass*i;
-    }
-    float centerOfMass = (float)sumMassR / sumMass;
-    return (int)(centerOfMass);
+    return findLineRaw(currentFrame, imageWidth, row);
 }
 
 // change the color of a pixel for visualization purposes
 void setPixel(int row, int col, uint8_t r, uint8_t g, uint8_t b){
-    int index = row*IMAGESIZEX+col;
+    int index = row*imageWidth+col;
     picture.r[index] = r;
     picture.g[index] = g;
     picture.b[index] = b;
@@ -357,7 +683,7 @@ void setPixel(int row, int col, uint8_t r, uint8_t g, uint8_t b){
 // print out the image to computer
 void printImage(){
     int i = 0;
-    for(i=0;i<IMAGESIZEX*IMAGESIZEY;i++){
+    for(i=0;i<imageWidth*imageHeight;i++){
         printf("%d %d %d %d\r\n", i, picture.r[i], picture.g[i], picture.b[i]);
     }
 }
\ No newline at end of file
@@ -6,7 +6,12 @@
 #include "hardware/i2c.h"
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "ov7670.h"
+#include "cam.pio.h"
 
 // I2C defines
 #define I2C_PORT i2c1
@@ -38,11 +43,20 @@
 
 // RGB565 example:
 // https://blog.usedbytes.com/2022/02/pico-pio-camera/
+// D0-D7 are sampled by a PIO program on rising PCLK while HS is high,
+// and DMA moves the bytes into cameraData (see cam.pio)
 
 void init_camera_pins();
 void init_camera();
 void setSaveImage(uint32_t);
 uint32_t getSaveImage();
+void setCaptureCallback(void (*callback)(void));
+void startContinuousCapture();
+void stopContinuousCapture();
+uint32_t getFrameCount();
+uint32_t getDroppedFrames();
+void setCaptureRows(int firstRow, int numRows);
+float getCaptureFps();
 uint32_t getHSCount();
 uint32_t getPixelCount();
 void convertImage();
@@ -50,26 +64,51 @@ void printImage();
 int findLine(int row);
 void setPixel(int row, int col, uint8_t r, uint8_t g, uint8_t b);
 
-static volatile uint8_t saveImage = 0; // user requests image
-static volatile uint8_t startImage = 0; // got a start of frame
-static volatile uint8_t startCollect = 0; // got a start of row
-static volatile uint32_t rawIndex = 0;
-static volatile uint32_t hsCount = 0;
-static volatile uint32_t vsCount = 0;
+static volatile uint8_t saveImage = 0; // user requests image, cleared when the DMA finishes
+// size the camera starts at, change it with camera_set_size()
 #define IMAGESIZEX 80
 #define IMAGESIZEY 60
-static volatile uint8_t cameraData[IMAGESIZEX*IMAGESIZEY*2];
+#define IMAGESIZE OV7670_SIZE_DIV8
+// biggest size camera_set_size() can fit in RAM (OV7670_SIZE_DIV4), for buffers that hold a copy of a frame
+#define CAM_MAX_WIDTH 160
+#define CAM_MAX_HEIGHT 120
+// how long camera_set_size() waits for the control loop to release its frame
+#define CAM_RESIZE_TIMEOUT_US 200000
 
+// two raw frames, the camera fills one while the control loop works on the other
+#define CAM_NUM_BUFFERS 2
+
+typedef struct cameraFrame{
+    const volatile uint8_t *data; // raw RGB565, 2 bytes per pixel
+    uint32_t sequence;            // frame number, gaps mean dropped frames
+    uint64_t timestamp;           // us since boot when the last byte arrived
+    int firstRow;                 // image row that data starts at (region of interest)
+    int numRows;                  // rows in data
+    int width;                    // pixels per row
+} cameraFrame_t;
+
+bool getFrame(cameraFrame_t *frame);
+void waitFrame(cameraFrame_t *frame);
+void releaseFrame();
+
+bool camera_set_size(OV7670_size size);
+OV7670_size camera_get_size();
+int getImageWidth();
+int getImageHeight();
+
+// converted picture for printImage(), the planes live in the same allocation as the raw frames
 typedef struct cameraImage{
     uint32_t index;
-    uint8_t r[IMAGESIZEX*IMAGESIZEY];
-    uint8_t g[IMAGESIZEX*IMAGESIZEY];
-    uint8_t b[IMAGESIZEX*IMAGESIZEY];
+    uint8_t *r;
+    uint8_t *g;
+    uint8_t *b;
 } cameraImage_t;
-static volatile struct cameraImage picture;
 // I2C functions
 void OV7670_write_register(uint8_t reg, uint8_t value);
 uint8_t OV7670_read_register(uint8_t reg);
+int OV7670_write_table(const uint8_t table[][2]);
+int OV7670_verify_registers();
+uint32_t getCameraInitTime();
 void OV7670_test_pattern(OV7670_pattern pattern);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,169 @@
+// camctl.c
+// exposure, gain and white balance loop, see camctl.h
+#include "cam.h"
+#include "camctl.h"
+
+// channel sums over every CAMCTL_ROW_STEP'th row of the band, the rows are raw RGB565 low byte first
+void camctl_measure(const volatile uint8_t *data, int width, int numRows, uint32_t frame, camStats_t *stats){
+    uint32_t sumR = 0, sumG = 0, sumB = 0, clipped = 0, n = 0;
+    int row, i;
+    for (row = CAMCTL_ROW_STEP / 2; row < numRows; row += CAMCTL_ROW_STEP){
+        const volatile uint8_t *p = data + row*width*2;
+        for (i = 0; i < width; i++){
+            uint16_t px = (uint16_t)(p[2*i] | (p[2*i+1] << 8));
+            uint32_t r = px >> 11, g = (px >> 5) & 0x3F, b = px & 0x1F;
+            sumR += r;
+            sumG += g;
+            sumB += b;
+            clipped += (r == 0x1F || g == 0x3F || b == 0x1F);
+        }
+        n += width;
+    }
+    if (n == 0){
+        return;
+    }
+    stats->frame = frame;
+    stats->mean = (uint16_t)((8*sumR + 4*sumG + 8*sumB) / n); // r+g+b the way line.c adds it up
+    stats->r = (uint8_t)(8*sumR / n);
+    stats->g = (uint8_t)(4*sumG / n);
+    stats->b = (uint8_t)(8*sumB / n);
+    stats->clipped = (uint8_t)(100*clipped / n);
+}
+
+// AEC[15:0] is spread over AECHH[5:0], AECH and COM1[1:0]
+static uint16_t read_exposure(){
+    return (uint16_t)(((OV7670_read_register(OV7670_REG_AECHH) & 0x3F) << 10)
+                      | (OV7670_read_register(OV7670_REG_AECH) << 2)
+                      | (OV7670_read_register(OV7670_REG_COM1) & 0x03));
+}
+
+static void write_exposure(uint16_t exposure){
+    uint8_t com1 = OV7670_read_register(OV7670_REG_COM1);
+    uint8_t aechh = OV7670_read_register(OV7670_REG_AECHH);
+    OV7670_write_register(OV7670_REG_COM1, (com1 & ~0x03) | (exposure & 0x03));
+    OV7670_write_register(OV7670_REG_AECH, (exposure >> 2) & 0xFF);
+    OV7670_write_register(OV7670_REG_AECHH, (aechh & ~0x3F) | ((exposure >> 10) & 0x3F));
+}
+
+// GAIN bits 7:4 each double the gain and bits 3:0 add 1/16 steps on top, so 2^d * (1 + f/16).
+// The VREF bits 9:8 are left at 0
+static uint8_t gain_register(uint16_t gain){
+    uint8_t doublings = 0;
+    while (gain >= 32 && doublings < 4){
+        gain /= 2;
+        doublings++;
+    }
+    uint8_t fraction = gain - 16;
+    if (fraction > 15) fraction = 15;
+    return (uint8_t)((((1 << doublings) - 1) << 4) | fraction);
+}
+
+static uint16_t gain_value(uint8_t reg){
+    uint16_t gain = 16 + (reg & 0x0F);
+    int bit;
+    for (bit = 4; bit < 8; bit++){
+        if (reg & (1 << bit)) gain *= 2;
+    }
+    return gain;
+}
+
+void camctl_init(camControl_t *c){
+    c->state = CAMCTL_OFF;
+    c->exposure = read_exposure();
+    c->gain = gain_value(OV7670_read_register(OV7670_REG_GAIN));
+    c->red = OV7670_read_register(OV7670_REG_RED);
+    c->blue = OV7670_read_register(OV7670_REG_BLUE);
+    c->wait_until = 0;
+    c->stable = 0;
+    c->frames = 0;
+    c->writes = 0;
+}
+
+void camctl_calibrate(camControl_t *c){
+    c->state = CAMCTL_CALIBRATING;
+    c->stable = 0;
+    c->frames = 0;
+}
+
+void camctl_track(camControl_t *c){
+    c->state = CAMCTL_TRACKING;
+}
+
+void camctl_lock(camControl_t *c){
+    c->state = CAMCTL_LOCKED;
+}
+
+const char *camctl_state_name(const camControl_t *c){
+    static const char *names[] = {"off", "calibrating", "locked", "tracking"};
+    return names[c->state];
+}
+
+static uint8_t step_channel(uint8_t gain, int have, int want){
+    int next = gain + (want - have) / 2; // half way there, the channel gain is roughly proportional
+    if (next < 0x20) next = 0x20;
+    if (next > 0xFF) next = 0xFF;
+    return (uint8_t)next;
+}
+
+bool camctl_update(camControl_t *c, const camStats_t *s){
+    if (c->state == CAMCTL_OFF || c->state == CAMCTL_LOCKED || s->frame == 0 || s->frame < c->wait_until){
+        return false; // nothing to do, or the last write hasn't shown up in a frame yet
+    }
+    c->frames++;
+
+    // exposure * gain is the total, aim it at the target in proportion, at most x2 or /2 a step
+    uint32_t total = (uint32_t)c->exposure * c->gain;
+    uint32_t mean = s->mean > 0 ? s->mean : 1;
+    uint32_t want = total * CAMCTL_TARGET / mean;
+    if (s->clipped > CAMCTL_MAX_CLIPPED && want > total * 4 / 5){
+        want = total * 4 / 5; // the line is blown out, whatever the average says
+    }
+    if (want > 2*total) want = 2*total;
+    if (want < total / 2) want = total / 2;
+
+    // longest exposure first (less noise), then gain
+    uint32_t exposure = want / CAMCTL_MIN_GAIN;
+    if (exposure > CAMCTL_MAX_EXPOSURE) exposure = CAMCTL_MAX_EXPOSURE;
+    if (exposure < CAMCTL_MIN_EXPOSURE) exposure = CAMCTL_MIN_EXPOSURE;
+    uint32_t gain = want / exposure;
+    if (gain > CAMCTL_MAX_GAIN) gain = CAMCTL_MAX_GAIN;
+    if (gain < CAMCTL_MIN_GAIN) gain = CAMCTL_MIN_GAIN;
+
+    // grey world white balance: the floor should come out grey, pull red and blue to green
+    uint8_t red = c->red, blue = c->blue;
+    if (c->state == CAMCTL_CALIBRATING){
+        red = step_channel(c->red, s->r, s->g);
+        blue = step_channel(c->blue, s->b, s->g);
+    }
+
+    bool onTarget = (s->mean + CAMCTL_TOLERANCE >= CAMCTL_TARGET && s->mean <= CAMCTL_TARGET + CAMCTL_TOLERANCE
+                     && s->clipped <= CAMCTL_MAX_CLIPPED);
+    bool changed = false;
+    if (!onTarget && (exposure != c->exposure || gain_register(gain) != gain_register(c->gain))){
+        c->exposure = exposure;
+        c->gain = gain;
+        write_exposure(c->exposure);
+        OV7670_write_register(OV7670_REG_GAIN, gain_register(c->gain));
+        changed = true;
+    }
+    if (red != c->red || blue != c->blue){
+        c->red = red;
+        c->blue = blue;
+        OV7670_write_register(OV7670_REG_RED, c->red);
+        OV7670_write_register(OV7670_REG_BLUE, c->blue);
+        changed = true;
+    }
+    if (changed){
+        c->wait_until = s->frame + 1 + CAMCTL_SETTLE_FRAMES;
+        c->writes++;
+        c->stable = 0;
+    }
+    else if (onTarget){
+        c->stable++;
+    }
+
+    if (c->state == CAMCTL_CALIBRATING && (c->stable >= CAMCTL_STABLE_FRAMES || c->frames >= CAMCTL_CALIBRATION_FRAMES)){
+        c->state = CAMCTL_LOCKED;
+    }
+    return changed;
+}
@@ -0,0 +1,64 @@
+// camctl.h
+// Our own exposure, gain and white balance loop for the OV7670. The camera's AEC/AGC/AWB stay off
+// (COM8 in ov7670.h), so the picture only changes when we change it: the loop runs while
+// calibrating, then the registers are locked and the line threshold sees the same brightness
+// every frame.
+//
+// Core 0 measures each frame it already has in hand (camctl_measure, a few rows only), the
+// stats go to core 1 with the telemetry and core 1 runs camctl_update, which does the slow
+// SCCB register writes.
+#ifndef CAMCTL_H
+#define CAMCTL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CAMCTL_TARGET 300          // mean r+g+b of the measured rows to aim for (0 to 748)
+#define CAMCTL_TOLERANCE 30        // close enough to the target
+#define CAMCTL_MAX_CLIPPED 2       // percent of pixels allowed to hit full scale
+#define CAMCTL_ROW_STEP 4          // measure every 4th row
+#define CAMCTL_SETTLE_FRAMES 2     // frames after a register write that still show the old settings
+#define CAMCTL_STABLE_FRAMES 5     // on target this many measurements in a row to finish calibrating
+#define CAMCTL_CALIBRATION_FRAMES 90 // give up and lock after this many frames (3 s at 30 fps)
+#define CAMCTL_MAX_EXPOSURE 500    // rows of exposure, more than a frame of rows drops the frame rate
+#define CAMCTL_MIN_EXPOSURE 1
+#define CAMCTL_MAX_GAIN 128        // 8x, gain is in 1/16 steps
+#define CAMCTL_MIN_GAIN 16
+
+typedef struct camStats{
+    uint32_t frame;   // camera sequence number the stats came from, 0 = none yet
+    uint16_t mean;    // mean r+g+b, same scale as the line threshold
+    uint8_t r, g, b;  // channel means, 0 to 255
+    uint8_t clipped;  // percent of pixels with a channel at full scale
+} camStats_t;
+
+typedef enum {
+    CAMCTL_OFF,         // leave the registers alone
+    CAMCTL_CALIBRATING, // loop running, locks itself once it settles
+    CAMCTL_LOCKED,      // registers fixed
+    CAMCTL_TRACKING,    // loop running all the time, follows lighting changes
+} camctlState_t;
+
+typedef struct camControl{
+    camctlState_t state;
+    uint16_t exposure;   // rows, AEC[15:0]
+    uint16_t gain;       // x16, 16 = 1x
+    uint8_t red, blue;   // white balance channel gains, 0x80 = 1x
+    uint32_t wait_until; // first frame that shows the last write
+    int stable;          // measurements in a row on target
+    int frames;          // measurements since calibration started
+    uint32_t writes;     // register updates, for the log
+} camControl_t;
+
+// core 0
+void camctl_measure(const volatile uint8_t *data, int width, int numRows, uint32_t frame, camStats_t *stats);
+
+// core 1, camctl_init reads the registers the init table left
+void camctl_init(camControl_t *c);
+void camctl_calibrate(camControl_t *c);
+void camctl_track(camControl_t *c);
+void camctl_lock(camControl_t *c);
+bool camctl_update(camControl_t *c, const camStats_t *stats); // true if it wrote the registers
+const char *camctl_state_name(const camControl_t *c);
+
+#endif
@@ -0,0 +1,65 @@
+// control.c
+// line fit to steering to motor PWM, see control.h
+#include <math.h>
+#include "control.h"
+#include "motor.h"
+
+void control_init(lineControl_t *c, int width, int height, float dt) {
+    c->width = width;
+    c->height = height;
+    c->nearRow = height - 1;
+    c->lookahead = c->nearRow - height / 2;
+    lineEstimate_t none = {0};
+    c->line = none;
+    c->found = false;
+    c->position = width / 2;
+    c->com = width / 2;
+    c->left_speed = 0;
+    c->right_speed = 0;
+    setLineRows(c->nearRow, LINE_FAR_ROW, LINE_ROWS);
+    pid_init(&c->pid, 0, STEER_KI, STEER_KD, dt, STEER_D_CUTOFF_HZ);
+}
+
+// fit the line through several rows of a new frame, on a gap keep steering at the last place we saw it
+// data holds numRows rows of RGB565 starting at image row firstRow
+bool control_frame(lineControl_t *c, const volatile uint8_t *data, int firstRow, int numRows) {
+    c->found = estimateLine(data, c->width, firstRow, numRows, &c->line);
+    if (c->found) {
+        float position = c->width / 2 + linePosition(&c->line, c->lookahead); // center of line
+        if (position < 0) position = 0;
+        if (position > c->width - 1) position = c->width - 1;
+        c->position = position;
+        c->com = (int)position;
+    }
+    return c->found;
+}
+
+static float clamp_speed(float speed) {
+    if (speed < MOTOR_MIN) return MOTOR_MIN;
+    if (speed > MOTOR_MAX) return MOTOR_MAX;
+    return speed;
+}
+
+// steer with the PID and slow down for curves
+void control_step(lineControl_t *c, float gain) {
+    float base_speed = BASE_SPEED_MAX - CURVE_SLOWDOWN * fabsf(c->line.curvature);
+    if (base_speed < BASE_SPEED_MIN) base_speed = BASE_SPEED_MIN;
+
+    // a turn bigger than the whole motor range can't do anything more
+    float range = MOTOR_MAX - MOTOR_MIN;
+    pid_set_limits(&c->pid, PID_FROM_FLOAT(-range), PID_FROM_FLOAT(range));
+    pid_set_kp(&c->pid, gain);
+
+    int setpoint = c->width / 2;  // center of image
+    q16_t turn = pid_update(&c->pid, PID_FROM_INT(setpoint), PID_FROM_FLOAT(c->position));
+    float turn_adjust = PID_TO_FLOAT(turn);
+    c->left_speed = clamp_speed(base_speed + turn_adjust);  // adjust left motor speed
+    c->right_speed = clamp_speed(base_speed - turn_adjust); // adjust right motor speed
+
+    // each wheel clamps on its own, so the turn that really happens can be less than the PID asked for.
+    // Don't let the integral wind up on the part the wheels couldn't do
+    float applied = (c->left_speed - c->right_speed) / 2;
+    pid_saturated(&c->pid, turn, PID_FROM_FLOAT(applied));
+    motor_set_speed(IN1_PIN, c->left_speed);   // left motor
+    motor_set_speed(IN2_PIN, c->right_speed);  // right motor
+}
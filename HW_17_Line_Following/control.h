@@ -0,0 +1,49 @@
+// control.h
+// One step of the line follower: find the line in a camera frame, then steer the motors.
+// Nothing in here touches the camera or the timers, so the host simulator (sim/) runs
+// exactly this code against rendered frames.
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "line.h"
+#include "pid.h"
+
+// rows scanned for the line, from the bottom row of the image (closest to the robot) up to LINE_FAR_ROW
+#define LINE_FAR_ROW 10
+#define LINE_ROWS 8
+
+#define MOTOR_MIN 0
+#define MOTOR_MAX 0.75f // max PWM speed for motors
+
+// steering PID, the error is in pixels and the output is the PWM difference between the wheels
+// kp comes from the potentiometer, these are per second
+#define STEER_KI 0.02f
+#define STEER_KD 0.004f
+#define STEER_D_CUTOFF_HZ 8.0f // the camera only updates ~30 times a second, keep the derivative below that
+
+// base speed drops in curves: BASE_SPEED_MAX on a straight, less by CURVE_SLOWDOWN per pixel/row^2 of curvature
+#define BASE_SPEED_MAX 0.6f
+#define BASE_SPEED_MIN 0.35f
+#define CURVE_SLOWDOWN 10.0f
+
+typedef struct lineControl{
+    int width;            // image size the rows and setpoint are worked out for
+    int height;
+    int nearRow;          // bottom row of the image
+    float lookahead;      // steer towards where the line will be this many rows past the near row
+    lineEstimate_t line;  // last fit, kept through frames where the line is lost
+    bool found;           // the last frame had a line
+    float position;       // where to steer, in pixels from the left edge
+    int com;              // position rounded down, for the display
+    pidController_t pid;
+    float left_speed;
+    float right_speed;
+} lineControl_t;
+
+void control_init(lineControl_t *c, int width, int height, float dt);
+bool control_frame(lineControl_t *c, const volatile uint8_t *data, int firstRow, int numRows);
+void control_step(lineControl_t *c, float gain);
+
+#endif
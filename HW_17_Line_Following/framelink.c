@@ -0,0 +1,277 @@
+// framelink.c
+// packing and checking framelink packets, see framelink.h. No hardware in here,
+// the sim uses the same code to read recordings
+#include <stddef.h>
+#include "framelink.h"
+#include "line.h"
+
+static uint32_t crcTable[256];
+static bool crcReady = false;
+
+// reflected CRC-32, polynomial 0x04C11DB7, same as zlib.crc32 on the host
+static void initCrc(){
+    uint32_t i;
+    int k;
+    for (i = 0; i < 256; i++){
+        uint32_t c = i;
+        for (k = 0; k < 8; k++){
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+        crcTable[i] = c;
+    }
+    crcReady = true;
+}
+
+// start with crc = 0, pass the last result back in to continue over more bytes
+uint32_t framelink_crc32(uint32_t crc, const uint8_t *data, uint32_t len){
+    if (!crcReady){
+        initCrc();
+    }
+    crc = ~crc;
+    while (len--){
+        crc = crcTable[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t packetCrc(const framelinkHeader_t *h, const uint8_t *payload){
+    uint32_t crc = framelink_crc32(0, (const uint8_t *)h, offsetof(framelinkHeader_t, crc));
+    return framelink_crc32(crc, payload, h->size);
+}
+
+void framelink_header(framelinkHeader_t *h, uint8_t format, int width, int height, int firstRow, int numRows,
+                      uint16_t reference, uint32_t sequence, uint64_t timestamp, const uint8_t *payload, uint32_t size){
+    h->magic = FRAMELINK_MAGIC;
+    h->version = FRAMELINK_VERSION;
+    h->format = format;
+    h->width = (uint16_t)width;
+    h->height = (uint16_t)height;
+    h->firstRow = (uint16_t)firstRow;
+    h->numRows = (uint16_t)numRows;
+    h->reference = reference;
+    h->timestamp = timestamp;
+    h->sequence = sequence;
+    h->size = size;
+    h->crc = packetCrc(h, payload);
+}
+
+bool framelink_check(const framelinkHeader_t *h, const uint8_t *payload){
+    if (h->magic != FRAMELINK_MAGIC || h->version != FRAMELINK_VERSION){
+        return false;
+    }
+    if (h->format > FRAMELINK_RGB565_DELTA){
+        return false;
+    }
+    uint32_t size = framelink_size(h->format, h->width, h->numRows);
+    bool compressed = (h->format == FRAMELINK_MONO_RLE || h->format == FRAMELINK_RGB565_DELTA);
+    if (compressed ? h->size > size : h->size != size){
+        return false;
+    }
+    return packetCrc(h, payload) == h->crc;
+}
+
+uint32_t framelink_size(uint8_t format, int width, int numRows){
+    uint32_t pixels = (uint32_t)width * numRows;
+    if (format == FRAMELINK_MONO){
+        return (uint32_t)((width + 7) / 8) * numRows;
+    }
+    if (format == FRAMELINK_MONO_RLE){
+        return (uint32_t)(width + 2*(width / 255) + 1) * numRows; // every pixel its own run, plus the splits
+    }
+    if (format == FRAMELINK_RGB565_DELTA){
+        return pixels * 2 + (pixels + 63) / 64; // raw pixels with a code byte every 64
+    }
+    return pixels * 2;
+}
+
+// brightness of every pixel in a row, returns the row average (the line threshold)
+static uint16_t rowBrightness(const volatile uint8_t *p, int width, uint16_t *bright){
+    uint32_t sum = 0;
+    int i;
+    for (i = 0; i < width; i++){
+        bright[i] = pixelBrightness(p[2*i], p[2*i+1]);
+        sum += bright[i];
+    }
+    return (uint16_t)(sum / width);
+}
+
+uint32_t framelink_pack_mono(uint8_t *dst, const volatile uint8_t *rgb565, int width, int numRows){
+    uint16_t bright[LINE_MAX_WIDTH];
+    uint8_t *out = dst;
+    int row, i;
+    if (width > LINE_MAX_WIDTH){
+        return 0;
+    }
+    for (row = 0; row < numRows; row++){
+        uint16_t avg = rowBrightness(&rgb565[2*width*row], width, bright);
+        uint8_t bits = 0;
+        for (i = 0; i < width; i++){
+            bits = (uint8_t)((bits << 1) | (bright[i] >= avg));
+            if ((i & 7) == 7){
+                *out++ = bits;
+                bits = 0;
+            }
+        }
+        if (width & 7){
+            *out++ = (uint8_t)(bits << (8 - (width & 7)));
+        }
+    }
+    return (uint32_t)(out - dst);
+}
+
+void framelink_unpack_mono(uint8_t *rgb565, const uint8_t *src, int width, int numRows){
+    int stride = (width + 7) / 8;
+    int row, i;
+    for (row = 0; row < numRows; row++){
+        for (i = 0; i < width; i++){
+            uint8_t v = (src[row*stride + i/8] & (0x80 >> (i & 7))) ? 0xFF : 0x00;
+            *rgb565++ = v;
+            *rgb565++ = v;
+        }
+    }
+}
+
+uint32_t framelink_encode_rle(uint8_t *dst, const volatile uint8_t *rgb565, int width, int numRows){
+    uint16_t bright[LINE_MAX_WIDTH];
+    uint8_t *out = dst;
+    int row, i;
+    if (width > LINE_MAX_WIDTH){
+        return 0;
+    }
+    for (row = 0; row < numRows; row++){
+        uint16_t avg = rowBrightness(&rgb565[2*width*row], width, bright);
+        bool colour = false; // rows start dark
+        int run = 0;
+        for (i = 0; i < width; i++){
+            if ((bright[i] >= avg) != colour){
+                *out++ = (uint8_t)run;
+                colour = !colour;
+                run = 0;
+            }
+            if (run == 255){
+                *out++ = 255;
+                *out++ = 0; // nothing of the other colour, carry on with this one
+                run = 0;
+            }
+            run++;
+        }
+        *out++ = (uint8_t)run;
+    }
+    return (uint32_t)(out - dst);
+}
+
+bool framelink_decode_rle(uint8_t *rgb565, const uint8_t *src, uint32_t size, int width, int numRows){
+    const uint8_t *end = src + size;
+    int row;
+    for (row = 0; row < numRows; row++){
+        int x = 0;
+        uint8_t v = 0x00;
+        while (x < width){
+            if (src == end){
+                return false;
+            }
+            int run = *src++;
+            if (x + run > width){
+                return false;
+            }
+            for (; run > 0; run--, x++){
+                *rgb565++ = v;
+                *rgb565++ = v;
+            }
+            v = ~v;
+        }
+    }
+    return src == end;
+}
+
+// channel changes that fit a one byte delta code, -1 if the pixel needs sending raw
+static int deltaCode(uint16_t cur, uint16_t prev){
+    int dr = (int)(cur >> 11) - (int)(prev >> 11);
+    int dg = (int)((cur >> 5) & 0x3F) - (int)((prev >> 5) & 0x3F);
+    int db = (int)(cur & 0x1F) - (int)(prev & 0x1F);
+    if (dr < -2 || dr > 1 || dg < -4 || dg > 3 || db < -2 || db > 1){
+        return -1;
+    }
+    return ((dr + 2) << 5) | ((dg + 4) << 2) | (db + 2);
+}
+
+uint32_t framelink_encode_delta(uint8_t *dst, uint32_t dstSize, const uint8_t *rgb565, const uint8_t *prev, int pixels){
+    uint8_t *out = dst;
+    uint8_t *limit = dst + dstSize;
+    int i = 0;
+    while (i < pixels){
+        uint16_t cur = (uint16_t)(rgb565[2*i] | (rgb565[2*i+1] << 8));
+        uint16_t old = (uint16_t)(prev[2*i] | (prev[2*i+1] << 8));
+        int n = 0;
+        if (cur == old){
+            // unchanged run
+            while (i + n < pixels && n < 64 && rgb565[2*(i+n)] == prev[2*(i+n)] && rgb565[2*(i+n)+1] == prev[2*(i+n)+1]){
+                n++;
+            }
+            if (out + 1 > limit) return 0;
+            *out++ = (uint8_t)(0x80 | (n - 1));
+        } else {
+            int code = deltaCode(cur, old);
+            if (code >= 0){
+                if (out + 1 > limit) return 0;
+                *out++ = (uint8_t)code;
+                n = 1;
+            } else {
+                // raw run, up to the next pixel a delta code can take
+                while (i + n < pixels && n < 64){
+                    uint16_t c = (uint16_t)(rgb565[2*(i+n)] | (rgb565[2*(i+n)+1] << 8));
+                    uint16_t o = (uint16_t)(prev[2*(i+n)] | (prev[2*(i+n)+1] << 8));
+                    if (n > 0 && (c == o || deltaCode(c, o) >= 0)){
+                        break;
+                    }
+                    n++;
+                }
+                if (out + 1 + 2*n > limit) return 0;
+                *out++ = (uint8_t)(0xC0 | (n - 1));
+                int k;
+                for (k = 0; k < 2*n; k++){
+                    *out++ = rgb565[2*i + k];
+                }
+            }
+        }
+        i += n;
+    }
+    return (uint32_t)(out - dst);
+}
+
+bool framelink_decode_delta(uint8_t *rgb565, const uint8_t *src, uint32_t size, int pixels){
+    const uint8_t *end = src + size;
+    int i = 0;
+    while (src < end){
+        uint8_t code = *src++;
+        if (code < 0x80){
+            if (i >= pixels){
+                return false;
+            }
+            uint16_t old = (uint16_t)(rgb565[2*i] | (rgb565[2*i+1] << 8));
+            uint16_t r = (uint16_t)((old >> 11) + ((code >> 5) & 3) - 2);
+            uint16_t g = (uint16_t)(((old >> 5) & 0x3F) + ((code >> 2) & 7) - 4);
+            uint16_t b = (uint16_t)((old & 0x1F) + (code & 3) - 2);
+            uint16_t px = (uint16_t)(((r & 0x1F) << 11) | ((g & 0x3F) << 5) | (b & 0x1F));
+            rgb565[2*i] = px & 0xFF;
+            rgb565[2*i+1] = px >> 8;
+            i++;
+        } else if (code < 0xC0){
+            i += (code & 0x3F) + 1; // unchanged, the previous frame is already there
+        } else {
+            int n = (code & 0x3F) + 1;
+            if (i + n > pixels || end - src < 2*n){
+                return false;
+            }
+            int k;
+            for (k = 0; k < 2*n; k++){
+                rgb565[2*i + k] = *src++;
+            }
+            i += n;
+        }
+        if (i > pixels){
+            return false;
+        }
+    }
+    return i == pixels;
+}
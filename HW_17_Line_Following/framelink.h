@@ -0,0 +1,93 @@
+// framelink.h
+// Binary camera frames over USB, replacing the "i r g b" text lines of printImage().
+// Every frame is a 36 byte little endian header followed by the payload:
+//
+//   offset  size
+//    0      4     magic "FLNK"
+//    4      1     version (1)
+//    5      1     format, FRAMELINK_RGB565, _MONO, _MONO_RLE or _RGB565_DELTA
+//    6      2     width, pixels per row
+//    8      2     height of the full image
+//   10      2     first row in the payload
+//   12      2     rows in the payload
+//   14      2     reference, for _RGB565_DELTA the low 16 bits of the sequence it is a delta against, else 0
+//   16      8     timestamp, us since boot when the last byte came off the camera
+//   24      4     frame sequence number
+//   28      4     payload size in bytes
+//   32      4     CRC-32 (zlib) of the header bytes before it and then the payload
+//
+// RGB565 payloads are the raw camera bytes, low byte first. MONO is one bit per pixel
+// (1 = at or above the row average, like findLineRaw), first pixel in the top bit, rows padded to a byte.
+//
+// The compressed formats, for streaming without taking the whole USB link:
+// MONO_RLE is the same threshold as MONO written as run lengths, one byte per run. Every row starts
+// with a dark run and the runs alternate dark/bright until they add up to the width, a run longer
+// than 255 is split with a 0 length run of the other colour. A row with the line in it is 3 bytes.
+// RGB565_DELTA is a frame against the previous one the host got, a stream of codes:
+//   0x00-0x7F  one pixel, previous + a small change: bits 6-5 red, 4-2 green, 1-0 blue,
+//              each stored +2/+4/+2 so red and blue move -2..1 and green -4..3
+//   0x80-0xBF  1-64 pixels unchanged
+//   0xC0-0xFF  1-64 pixels follow as raw RGB565
+// Every change fits exactly, so the host gets the same pixels as a raw frame.
+// A recording is just these packets back to back, text printed between them is skipped by
+// looking for the magic. python/framelink.py records and shows them, sim/line_sim --replay runs
+// a recording back through the line detector.
+#ifndef FRAMELINK_H
+#define FRAMELINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FRAMELINK_MAGIC 0x4B4E4C46 // "FLNK" in memory order
+#define FRAMELINK_VERSION 1
+#define FRAMELINK_RGB565 0
+#define FRAMELINK_MONO 1
+#define FRAMELINK_MONO_RLE 2
+#define FRAMELINK_RGB565_DELTA 3
+
+typedef struct __attribute__((packed)) framelinkHeader{ // no tail padding after crc
+    uint32_t magic;
+    uint8_t version;
+    uint8_t format;
+    uint16_t width;
+    uint16_t height;
+    uint16_t firstRow;
+    uint16_t numRows;
+    uint16_t reference;
+    uint64_t timestamp;
+    uint32_t sequence;
+    uint32_t size;
+    uint32_t crc;
+} framelinkHeader_t;
+
+_Static_assert(sizeof(framelinkHeader_t) == 36, "framelink header must match the wire format");
+
+uint32_t framelink_crc32(uint32_t crc, const uint8_t *data, uint32_t len);
+
+// fill in a header for payload, including its CRC
+void framelink_header(framelinkHeader_t *h, uint8_t format, int width, int height, int firstRow, int numRows,
+                      uint16_t reference, uint32_t sequence, uint64_t timestamp, const uint8_t *payload, uint32_t size);
+
+// true if the header is one we understand and the CRC matches the payload
+bool framelink_check(const framelinkHeader_t *h, const uint8_t *payload);
+
+// payload bytes for a band of rows, for the compressed formats the most they can take
+uint32_t framelink_size(uint8_t format, int width, int numRows);
+
+// threshold RGB565 rows into a MONO payload, returns its size
+uint32_t framelink_pack_mono(uint8_t *dst, const volatile uint8_t *rgb565, int width, int numRows);
+
+// MONO payload back to RGB565 (black and white) so the line detector can read it
+void framelink_unpack_mono(uint8_t *rgb565, const uint8_t *src, int width, int numRows);
+
+// encoders, return the payload size. The delta encoder gives up and returns 0 if the result
+// would not fit in dstSize, send the frame raw then
+uint32_t framelink_encode_rle(uint8_t *dst, const volatile uint8_t *rgb565, int width, int numRows);
+uint32_t framelink_encode_delta(uint8_t *dst, uint32_t dstSize, const uint8_t *rgb565, const uint8_t *prev, int pixels);
+
+// decoders to RGB565, false if the payload doesn't add up to the frame size.
+// For a delta frame rgb565 holds the previous frame on the way in
+bool framelink_decode_rle(uint8_t *rgb565, const uint8_t *src, uint32_t size, int width, int numRows);
+bool framelink_decode_delta(uint8_t *rgb565, const uint8_t *src, uint32_t size, int pixels);
+
+#endif
@@ -0,0 +1,383 @@
+// line.c
+// Fused RGB565 to brightness kernel for finding the line, two pixels per 32 bit word.
+// Gives exactly the same answer as the original convertImage() followed by the three pass findLine(row),
+// line_sim --check-kernel checks that on recorded frames.
+
+#include <math.h>
+#include "line.h"
+
+// r+g+b of a pixel splits into a part that only depends on the high byte
+// and a part that only depends on the low byte, so two small tables do the whole unpack:
+//   r = (hi>>3)<<3
+//   g = (((hi&0b111)<<3) | lo>>5)<<2  ->  ((hi&0b111)<<5) + ((lo>>5)<<2), the bits never overlap
+//   b = (lo&0b11111)<<3
+static uint16_t brightHi[256];
+static uint16_t brightLo[256];
+static bool tablesReady = false;
+
+static void initTables(){
+    int i;
+    for(i=0;i<256;i++){
+        brightHi[i] = ((i>>3)<<3) + ((i&0b111)<<5);
+        brightLo[i] = ((i>>5)<<2) + ((i&0b11111)<<3);
+    }
+    tablesReady = true;
+}
+
+// r+g+b of one pixel, lo is the first byte the camera sends
+uint16_t pixelBrightness(uint8_t lo, uint8_t hi){
+    if (!tablesReady){
+        initTables();
+    }
+    return brightHi[hi] + brightLo[lo];
+}
+
+// ---- row kernel ----
+// The camera sends lo0 hi0 lo1 hi1, so a little endian 32 bit word holds two whole pixels
+// (pixel0 | pixel1<<16) and r+g+b of both comes out in two 16 bit lanes with shifts and masks.
+// Each lane is at most 748, so lanes never carry into each other and the threshold compare
+// can be done on both at once too.
+#define LANE_R 0x001F001Fu
+#define LANE_G 0x003F003Fu
+#define LANE_TOP 0x80008000u
+
+static inline uint32_t pairBrightness(uint32_t w){
+    uint32_t r = (w >> 11) & LANE_R;
+    uint32_t g = (w >> 5) & LANE_G;
+    uint32_t b = w & LANE_R;
+    return ((r + b) << 3) + (g << 2); // same as brightHi[hi] + brightLo[lo] for each pixel
+}
+
+// 0x00010001 style mask: 1 in each lane that is >= threshold (t2 holds the threshold in both lanes)
+static inline uint32_t pairAtLeast(uint32_t bw, uint32_t t2){
+    return (((bw | LANE_TOP) - t2) >> 15) & 0x00010001u;
+}
+
+static inline uint32_t loadPair(const volatile uint8_t *p, int k, bool aligned){
+    if (aligned){
+        return ((const volatile uint32_t *)p)[k];
+    }
+    p += 4*k;
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+typedef struct rowStats{
+    int count;    // pixels at or above the threshold
+    int sumPos;   // sum of their positions
+    int sum;      // brightness of the whole row
+    int min;
+    int max;
+    int threshold;
+} rowStats_t;
+
+static inline void pixelMinMax(rowStats_t *s, int b){
+    if (b < s->min) s->min = b;
+    if (b > s->max) s->max = b;
+}
+
+// one row, threshold < 0 means the row's own average brightness (findLineRaw). The camera bytes are
+// read once and never written. hist, if given, gets every pixel added at brightness/LINE_HIST_STEP
+static void scanRow(const volatile uint8_t *p, int width, int threshold, uint16_t *hist, rowStats_t *s){
+    uint32_t packed[LINE_MAX_WIDTH / 2]; // brightness pairs, only needed when the threshold comes from this row
+    int pairs = width / 2;
+    bool aligned = ((uintptr_t)p & 3) == 0;
+    uint32_t laneSum = 0, laneCount = 0;
+    int sumPos = 0;
+    int k;
+
+    s->sum = 0;
+    s->min = 0xFFFF;
+    s->max = 0;
+    uint32_t t2 = (uint32_t)threshold * 0x00010001u;
+    for(k=0;k<pairs;k++){
+        uint32_t bw = pairBrightness(loadPair(p, k, aligned));
+        int b0 = bw & 0xFFFF, b1 = bw >> 16;
+        pixelMinMax(s, b0); // plain compares beat doing min/max lane by lane
+        pixelMinMax(s, b1);
+        if (hist != NULL){
+            hist[b0 / LINE_HIST_STEP]++;
+            hist[b1 / LINE_HIST_STEP]++;
+        }
+        laneSum += bw;
+        if ((k & 63) == 63){ // 64*748 still fits a lane
+            s->sum += (laneSum & 0xFFFF) + (laneSum >> 16);
+            laneSum = 0;
+        }
+        if (threshold < 0){
+            packed[k] = bw;
+        }
+        else {
+            uint32_t m = pairAtLeast(bw, t2);
+            laneCount += m;
+            sumPos += (m & 1)*(2*k) + (m >> 16)*(2*k + 1);
+        }
+    }
+    s->sum += (laneSum & 0xFFFF) + (laneSum >> 16);
+    int last = -1; // odd width, the last pixel on its own
+    if (width & 1){
+        last = pixelBrightness(p[2*(width-1)], p[2*(width-1)+1]);
+        s->sum += last;
+        pixelMinMax(s, last);
+        if (hist != NULL) hist[last / LINE_HIST_STEP]++;
+    }
+
+    if (threshold < 0){
+        // second pass over the packed brightness, not the camera bytes
+        threshold = s->sum / width;
+        t2 = (uint32_t)threshold * 0x00010001u;
+        for(k=0;k<pairs;k++){
+            uint32_t m = pairAtLeast(packed[k], t2);
+            laneCount += m;
+            sumPos += (m & 1)*(2*k) + (m >> 16)*(2*k + 1);
+        }
+    }
+    s->count = (laneCount & 0xFFFF) + (laneCount >> 16);
+    if (last >= threshold){
+        s->count++;
+        sumPos += width - 1;
+    }
+    s->sumPos = sumPos;
+    s->threshold = threshold;
+}
+
+// threshold a row at its average brightness and return the center of mass of the bright pixels
+int findLineRaw(const volatile uint8_t *frame, int width, int row){
+    return findLineRawStats(frame, width, row, NULL, NULL);
+}
+
+// findLineRaw that also reports the row contrast (brightest - darkest) and how many pixels were bright
+int findLineRawStats(const volatile uint8_t *frame, int width, int row, int *contrast, int *count){
+    rowStats_t s;
+    if (width > LINE_MAX_WIDTH){
+        width = LINE_MAX_WIDTH;
+    }
+    scanRow(frame + row*width*2, width, -1, NULL, &s); // 2 bytes per pixel
+    if (contrast != NULL) *contrast = s.max - s.min;
+    if (count != NULL) *count = s.count;
+    return s.sumPos / s.count; // never 0, the brightest pixel is always above the average
+}
+
+// single pass version with the threshold given (0 to 748, r+g+b), returns -1 if no pixel reached it
+int findLineThreshold(const volatile uint8_t *frame, int width, int row, int threshold, int *contrast, int *count){
+    rowStats_t s;
+    if (width > LINE_MAX_WIDTH){
+        width = LINE_MAX_WIDTH;
+    }
+    if (threshold < 0) threshold = 0;
+    if (threshold > 1023) threshold = 1023; // nothing is that bright, and it keeps the lane compare from borrowing
+    scanRow(frame + row*width*2, width, threshold, NULL, &s);
+    if (contrast != NULL) *contrast = s.max - s.min;
+    if (count != NULL) *count = s.count;
+    return s.count > 0 ? s.sumPos / s.count : -1;
+}
+
+// same as findLineRaw for a list of rows
+void findLineRows(const volatile uint8_t *frame, int width, const int *rows, int nrows, int *coms){
+    int i;
+    for(i=0;i<nrows;i++){
+        coms[i] = findLineRaw(frame, width, rows[i]);
+    }
+}
+
+// ---- multi row line estimate ----
+
+static int lineRows[LINE_MAX_ROWS] = {59, 51, 43, 35, 27, 19}; // near row first
+static int lineNumRows = 6;
+static int lineMinContrast = 90; // r+g+b difference a row needs to count as having a line
+
+// how the rows are thresholded, see lineThreshold_t
+static lineThreshold_t thresholdMode = LINE_THRESHOLD_MEAN;
+static int lineHysteresis = 24;      // row average has to move this far before the threshold follows it
+static int carriedThreshold = -1;    // hysteresis: the threshold carried from row to row and frame to frame
+static int otsuThreshold = -1;       // otsu: worked out from the last frame, -1 until there was one
+
+// scan nrows rows spread evenly from nearRow (closest to the robot) to farRow
+void setLineRows(int nearRow, int farRow, int nrows){
+    int i;
+    if (nrows > LINE_MAX_ROWS) nrows = LINE_MAX_ROWS;
+    if (nrows < 1) nrows = 1;
+    for(i=0;i<nrows;i++){
+        if (nrows == 1){
+            lineRows[i] = nearRow;
+        }
+        else {
+            lineRows[i] = nearRow + (farRow - nearRow)*i/(nrows - 1);
+        }
+    }
+    lineNumRows = nrows;
+}
+
+// the rows estimateLine scans, near row first, returns how many (at most LINE_MAX_ROWS)
+int getLineRows(int *rows){
+    int i;
+    for(i=0;i<lineNumRows;i++){
+        rows[i] = lineRows[i];
+    }
+    return lineNumRows;
+}
+
+void setLineMinContrast(int contrast){
+    lineMinContrast = contrast;
+}
+
+void setLineThreshold(lineThreshold_t mode){
+    thresholdMode = mode;
+    carriedThreshold = -1;
+    otsuThreshold = -1;
+}
+
+void setLineHysteresis(int band){
+    lineHysteresis = band;
+}
+
+// Otsu's method over the brightness histogram: the split that best separates floor from line
+static int otsu(const uint16_t *hist){
+    uint32_t total = 0;
+    float sumAll = 0;
+    int i;
+    for(i=0;i<LINE_HIST_BINS;i++){
+        total += hist[i];
+        sumAll += (float)i * hist[i];
+    }
+    if (total == 0){
+        return -1;
+    }
+    uint32_t below = 0;
+    float sumBelow = 0;
+    float best = -1;
+    int split = -1;
+    for(i=0;i<LINE_HIST_BINS-1;i++){
+        below += hist[i];
+        sumBelow += (float)i * hist[i];
+        uint32_t above = total - below;
+        if (below == 0 || above == 0){
+            continue;
+        }
+        float m0 = sumBelow / below;
+        float m1 = (sumAll - sumBelow) / above;
+        float between = (float)below * (float)above * (m1 - m0) * (m1 - m0);
+        if (between > best){
+            best = between;
+            split = i;
+        }
+    }
+    return split < 0 ? -1 : (split + 1) * LINE_HIST_STEP; // the line is at or above the top of the lower class
+}
+
+// where the estimate puts the line (pixels from the image center) rowsAhead rows past the near row
+float linePosition(const lineEstimate_t *est, float rowsAhead){
+    return est->offset + est->heading*rowsAhead + 0.5f*est->curvature*rowsAhead*rowsAhead;
+}
+
+// find the line in several rows and fit x(t) = a + b*t + c*t^2 through the centers, t is rows ahead of the near row.
+// frame holds numRows rows starting at image row firstRow, configured rows outside that are skipped, and so are
+// rows with too little contrast or where over half the row is bright (no line, just noise).
+// returns false if no row had a line, est keeps its old values then
+bool estimateLine(const volatile uint8_t *frame, int width, int firstRow, int numRows, lineEstimate_t *est){
+    float t[LINE_MAX_ROWS];
+    float x[LINE_MAX_ROWS];
+    int n = 0;
+    int i;
+    int nearRow = lineRows[0];
+    int dir = (lineNumRows > 1 && lineRows[lineNumRows-1] < nearRow) ? -1 : 1; // which way "ahead" is in the image
+    float center = width / 2.0f;
+
+    uint16_t hist[LINE_HIST_BINS] = {0};
+    if (width > LINE_MAX_WIDTH){
+        width = LINE_MAX_WIDTH;
+    }
+
+    for(i=0;i<lineNumRows;i++){
+        rowStats_t s;
+        if (lineRows[i] < firstRow || lineRows[i] >= firstRow + numRows){
+            continue;
+        }
+        const volatile uint8_t *row = frame + (lineRows[i] - firstRow)*width*2;
+        if (thresholdMode == LINE_THRESHOLD_OTSU){
+            scanRow(row, width, otsuThreshold, hist, &s); // row average until the first frame is in
+        }
+        else if (thresholdMode == LINE_THRESHOLD_HYSTERESIS){
+            scanRow(row, width, carriedThreshold, NULL, &s);
+            int avg = s.sum / width;
+            if (carriedThreshold < 0 || avg > carriedThreshold + lineHysteresis || avg < carriedThreshold - lineHysteresis){
+                carriedThreshold = avg;
+            }
+        }
+        else {
+            scanRow(row, width, -1, NULL, &s);
+        }
+        if (s.count == 0 || s.max - s.min < lineMinContrast || s.count > width / 2){
+            continue;
+        }
+        int com = s.sumPos / s.count;
+        t[n] = (float)((nearRow - lineRows[i]) * -dir);
+        x[n] = com - center;
+        n++;
+    }
+
+    if (thresholdMode == LINE_THRESHOLD_OTSU){
+        otsuThreshold = otsu(hist); // for the next frame, so every row stays a single pass
+    }
+
+    est->rowsFound = n;
+    if (n == 0){
+        est->confidence = 0;
+        return false;
+    }
+
+    // fit in units of the furthest row so the t^4 sums stay small enough for float
+    float scale = 1;
+    for(i=0;i<n;i++){
+        if (t[i] > scale) scale = t[i];
+    }
+    for(i=0;i<n;i++){
+        t[i] = t[i] / scale;
+    }
+
+    // sums for the least squares normal equations
+    float s0 = n, s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+    float sx = 0, stx = 0, st2x = 0;
+    for(i=0;i<n;i++){
+        float tt = t[i]*t[i];
+        s1 += t[i];
+        s2 += tt;
+        s3 += tt*t[i];
+        s4 += tt*tt;
+        sx += x[i];
+        stx += t[i]*x[i];
+        st2x += tt*x[i];
+    }
+
+    float a = sx / s0, b = 0, c = 0;
+    if (n >= 3){
+        // quadratic, solve the 3x3 system with Cramer's rule
+        float det = s0*(s2*s4 - s3*s3) - s1*(s1*s4 - s3*s2) + s2*(s1*s3 - s2*s2);
+        if (det != 0){
+            a = (sx*(s2*s4 - s3*s3) - s1*(stx*s4 - s3*st2x) + s2*(stx*s3 - s2*st2x)) / det;
+            b = (s0*(stx*s4 - st2x*s3) - sx*(s1*s4 - s3*s2) + s2*(s1*st2x - stx*s2)) / det;
+            c = (s0*(s2*st2x - s3*stx) - s1*(s1*st2x - s2*stx) + sx*(s1*s3 - s2*s2)) / det;
+        }
+    }
+    else if (n == 2){
+        // straight line
+        float det = s0*s2 - s1*s1;
+        if (det != 0){
+            a = (sx*s2 - s1*stx) / det;
+            b = (s0*stx - s1*sx) / det;
+        }
+    }
+
+    est->offset = a;
+    est->heading = b / scale;
+    est->curvature = 2*c / (scale*scale);
+
+    // confidence drops with missing rows and with how far the centers sit off the fit
+    float sumErr = 0;
+    for(i=0;i<n;i++){
+        float e = x[i] - (a + b*t[i] + c*t[i]*t[i]);
+        sumErr += e*e;
+    }
+    float rms = sqrtf(sumErr / n);
+    est->confidence = ((float)n / lineNumRows) / (1.0f + rms / 4.0f);
+    return true;
+}
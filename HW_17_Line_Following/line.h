@@ -0,0 +1,47 @@
+// line.h
+// Finds the line straight from the raw RGB565 camera bytes, without
+// unpacking the whole image into r/g/b planes first (see convertImage in cam.c).
+#ifndef LINE_H
+#define LINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LINE_MAX_WIDTH 640 // widest row the kernels accept (VGA)
+#define LINE_MAX_ROWS 16   // most rows estimateLine can scan per frame
+#define LINE_HIST_STEP 16  // brightness (r+g+b, 0-748) per histogram bin for the Otsu threshold
+#define LINE_HIST_BINS 48
+
+// how estimateLine splits line from floor in each row
+typedef enum {
+    LINE_THRESHOLD_MEAN,       // the row's own average, two passes (the second over packed brightness, not the camera bytes)
+    LINE_THRESHOLD_OTSU,       // Otsu's threshold from the last frame's rows, one pass
+    LINE_THRESHOLD_HYSTERESIS, // carried from row to row, only follows the row average when it moves past setLineHysteresis()
+} lineThreshold_t;
+
+// what estimateLine found, distances are in pixels and rows.
+// t counts rows ahead of the near row, so the line is at x(t) = center + offset + heading*t + curvature*t*t/2
+typedef struct lineEstimate{
+    float offset;      // line position at the near row, relative to the image center (+ is right)
+    float heading;     // sideways pixels per row ahead (0 is straight ahead)
+    float curvature;   // change of heading per row ahead
+    float confidence;  // 0 (no line) to 1 (every row found and on the fit)
+    int rowsFound;     // rows that had a usable line
+} lineEstimate_t;
+
+int findLineRaw(const volatile uint8_t *frame, int width, int row);
+int findLineRawStats(const volatile uint8_t *frame, int width, int row, int *contrast, int *count);
+int findLineThreshold(const volatile uint8_t *frame, int width, int row, int threshold, int *contrast, int *count);
+void findLineRows(const volatile uint8_t *frame, int width, const int *rows, int nrows, int *coms);
+uint16_t pixelBrightness(uint8_t lo, uint8_t hi);
+
+void setLineRows(int nearRow, int farRow, int nrows);
+int getLineRows(int *rows);
+void setLineMinContrast(int contrast);
+void setLineThreshold(lineThreshold_t mode);
+void setLineHysteresis(int band);
+bool estimateLine(const volatile uint8_t *frame, int width, int firstRow, int numRows, lineEstimate_t *est);
+float linePosition(const lineEstimate_t *est, float rowsAhead);
+
+#endif
@@ -0,0 +1,87 @@
+// pid.c
+// Derivative on measurement so a setpoint jump doesn't kick the output, a one pole low pass
+// on the derivative because the camera measurement is quantized and noisy, and an integral
+// that stops growing once the output is pinned at a limit (anti windup).
+#include <math.h>
+#include "pid.h"
+
+static inline q16_t qmul(q16_t a, q16_t b) {
+    return (q16_t)(((int64_t)a * b) >> PID_Q);
+}
+
+static inline q16_t qclamp(q16_t x, q16_t lo, q16_t hi) {
+    if (x < lo) return lo;
+    if (x > hi) return hi;
+    return x;
+}
+
+void pid_init(pidController_t *p, float kp, float ki, float kd, float dt, float d_cutoff_hz) {
+    p->kp = PID_FROM_FLOAT(kp);
+    p->ki_dt = PID_FROM_FLOAT(ki * dt);
+    p->kd_dt = PID_FROM_FLOAT(kd / dt);
+    if (d_cutoff_hz > 0) {
+        // discretized RC low pass: alpha = dt / (RC + dt)
+        float rc = 1.0f / (2.0f * (float)M_PI * d_cutoff_hz);
+        p->d_alpha = PID_FROM_FLOAT(dt / (rc + dt));
+    } else {
+        p->d_alpha = PID_ONE;
+    }
+    p->out_min = INT32_MIN;
+    p->out_max = INT32_MAX;
+    pid_reset(p);
+}
+
+void pid_set_kp(pidController_t *p, float kp) {
+    p->kp = PID_FROM_FLOAT(kp);
+}
+
+// the integral is clamped along with the output, so it never holds more than the output can use
+void pid_set_limits(pidController_t *p, q16_t out_min, q16_t out_max) {
+    p->out_min = out_min;
+    p->out_max = out_max;
+    p->integral = qclamp(p->integral, out_min, out_max);
+}
+
+void pid_reset(pidController_t *p) {
+    p->integral = 0;
+    p->last_integral = 0;
+    p->derivative = 0;
+    p->last_measurement = 0;
+    p->primed = false;
+}
+
+q16_t pid_update(pidController_t *p, q16_t setpoint, q16_t measurement) {
+    q16_t error = setpoint - measurement;
+    q16_t proportional = qmul(p->kp, error);
+
+    // derivative of -measurement, same sign as the derivative of the error while the setpoint holds still
+    if (p->primed) {
+        q16_t raw = qmul(p->kd_dt, p->last_measurement - measurement);
+        p->derivative += qmul(p->d_alpha, raw - p->derivative);
+    }
+    p->last_measurement = measurement;
+    p->primed = true;
+
+    // only keep the new integral if it doesn't push an already saturated output further
+    p->last_integral = p->integral;
+    q16_t integral = qclamp(p->integral + qmul(p->ki_dt, error), p->out_min, p->out_max);
+    int64_t out = (int64_t)proportional + integral + p->derivative;
+    if ((out > p->out_max && error > 0) || (out < p->out_min && error < 0)) {
+        out = (int64_t)proportional + p->integral + p->derivative;
+    } else {
+        p->integral = integral;
+    }
+
+    if (out > p->out_max) return p->out_max;
+    if (out < p->out_min) return p->out_min;
+    return (q16_t)out;
+}
+
+// anti windup for limits pid_set_limits() can't express, like two wheels that clamp on their own:
+// drop the last integral step if it pushed the same way the output got cut off
+void pid_saturated(pidController_t *p, q16_t output, q16_t applied) {
+    q16_t step = p->integral - p->last_integral;
+    if ((applied < output && step > 0) || (applied > output && step < 0)) {
+        p->integral = p->last_integral;
+    }
+}
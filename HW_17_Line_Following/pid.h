@@ -0,0 +1,42 @@
+// pid.h
+// Fixed point PID controller. Values are Q16.16 (1.0 is 65536) so the update is
+// integer multiplies and shifts only, the float conversions happen once in pid_init.
+#ifndef PID_H
+#define PID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int32_t q16_t;
+
+#define PID_Q 16
+#define PID_ONE (1 << PID_Q)
+#define PID_FROM_FLOAT(x) ((q16_t)((x) * (float)PID_ONE))
+#define PID_FROM_INT(x) ((q16_t)((x) * PID_ONE))
+#define PID_TO_FLOAT(x) ((float)(x) / (float)PID_ONE)
+
+typedef struct pidController{
+    q16_t kp;          // output per unit of error
+    q16_t ki_dt;       // ki * dt, added to the integral every update
+    q16_t kd_dt;       // kd / dt, applied to the change in measurement
+    q16_t d_alpha;     // derivative low pass, PID_ONE is no filtering
+    q16_t out_min;
+    q16_t out_max;
+
+    q16_t integral;    // kept in output units so it can be clamped to the output range
+    q16_t last_integral; // before the last update, pid_saturated() can go back to it
+    q16_t derivative;  // filtered derivative term
+    q16_t last_measurement;
+    bool primed;       // false until the first update has a measurement to difference against
+} pidController_t;
+
+// gains are per second, dt is the update period. d_cutoff_hz 0 turns the derivative filter off
+void pid_init(pidController_t *p, float kp, float ki, float kd, float dt, float d_cutoff_hz);
+void pid_set_kp(pidController_t *p, float kp);
+void pid_set_limits(pidController_t *p, q16_t out_min, q16_t out_max);
+void pid_reset(pidController_t *p);
+q16_t pid_update(pidController_t *p, q16_t setpoint, q16_t measurement);
+// the caller could only apply part of the last output, its own limits saturated
+void pid_saturated(pidController_t *p, q16_t output, q16_t applied);
+
+#endif
@@ -0,0 +1,69 @@
+# camera.py
+# Live view of the line follower camera over USB, framelink packets instead of text lines
+#
+# python3 -m pip install -r requirements.txt
+# python3 camera.py            (set the port below, 'm' in the window toggles 1 bit frames,
+#                               'z' toggles compression, the robot keeps driving the whole time)
+
+import pgzrun  # pip install pgzero
+import pygame
+import numpy as np
+import serial
+
+from framelink import Reader, FORMATS
+
+ser = serial.Serial('COM4', timeout=0)  # the name of your port here
+print('Opening port: ' + str(ser.name))
+
+SCALE = 5
+WIDTH = 80 * SCALE
+HEIGHT = 60 * SCALE + 40
+
+reader = Reader()
+image = None
+status = 'waiting for frames'
+mono = False
+compress = True
+count = 0
+ratio = 0.0
+
+
+def start():
+    ser.write(b'z' if compress else b'u')
+    ser.write(b'm' if mono else b'v')
+
+
+def update():
+    global image, status, count, ratio
+    data = ser.read(ser.in_waiting or 1)
+    for frame, _ in reader.feed(data):
+        if frame.pixels is None:
+            continue  # a delta without its frame, the next raw one fixes it
+        rgb = np.zeros((frame.height, frame.width, 3), dtype=np.uint8)
+        rgb[frame.first_row:frame.first_row + frame.num_rows] = frame.rgb()
+        image = pygame.transform.scale(pygame.surfarray.make_surface(rgb.swapaxes(0, 1)),
+                                       (frame.width * SCALE, frame.height * SCALE))
+        count += 1
+        ratio += frame.ratio()
+        status = 'frame %d  %s  %d bytes  compression %.2f (mean %.2f)  bad %d' % (
+            frame.sequence, FORMATS[frame.format], frame.size, frame.ratio(), ratio / count, reader.bad)
+
+
+def on_key_down(key):
+    global mono, compress
+    if key == keys.M:
+        mono = not mono
+    elif key == keys.Z:
+        compress = not compress
+    start()
+
+
+def draw():
+    screen.fill((0, 0, 0))
+    if image is not None:
+        screen.blit(image, (0, 0))
+    screen.draw.text(status, (4, HEIGHT - 30), fontsize=18)
+
+
+start()
+pgzrun.go()
@@ -0,0 +1,316 @@
+# framelink.py
+# Records and shows the binary camera frames the line follower sends over USB (see framelink.h)
+#
+# python3 -m pip install -r requirements.txt  (numpy, pyserial, matplotlib)
+#
+#   python3 framelink.py record COM4 run1.flk            # stream colour frames until Ctrl+C
+#   python3 framelink.py record COM4 run1.flk --mono -n 300
+#   python3 framelink.py record COM4 run1.flk --compress # deltas / run lengths, see framelink.h
+#   python3 framelink.py show run1.flk                   # step through a recording
+#   python3 framelink.py stats run1.flk
+#
+# A recording is the raw packets back to back, so sim/line_sim --replay run1.flk
+# runs it through the same line detector the robot uses.
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+import numpy as np
+
+MAGIC = b'FLNK'
+VERSION = 1
+RGB565 = 0
+MONO = 1
+MONO_RLE = 2
+RGB565_DELTA = 3
+FORMATS = ['rgb565', 'mono', 'rle', 'delta']
+# magic, version, format, width, height, first row, rows, reference, timestamp, sequence, size, crc
+HEADER = struct.Struct('<4sBBHHHHHQIII')
+
+
+def payload_size(fmt, width, rows):
+    """bytes in a payload, for the compressed formats the most it can be"""
+    pixels = width * rows
+    if fmt == MONO:
+        return (width + 7) // 8 * rows
+    if fmt == MONO_RLE:
+        return (width + 2 * (width // 255) + 1) * rows
+    if fmt == RGB565_DELTA:
+        return pixels * 2 + (pixels + 63) // 64
+    return pixels * 2
+
+
+def decode_rle(payload, width, rows):
+    """run lengths to one byte per pixel (0 or 255), None if they don't add up"""
+    out = bytearray()
+    pos = 0
+    for _ in range(rows):
+        x = 0
+        value = 0
+        while x < width:
+            if pos == len(payload):
+                return None
+            run = payload[pos]
+            pos += 1
+            if x + run > width:
+                return None
+            out += bytes((value,)) * run
+            x += run
+            value ^= 255
+    return bytes(out) if pos == len(payload) else None
+
+
+def decode_delta(payload, prev, pixels):
+    """apply a delta payload to the previous RGB565 frame, None if it doesn't fit"""
+    out = bytearray(prev)
+    i = 0
+    pos = 0
+    while pos < len(payload):
+        code = payload[pos]
+        pos += 1
+        if code < 0x80:
+            if i >= pixels:
+                return None
+            old = out[2 * i] | (out[2 * i + 1] << 8)
+            r = ((old >> 11) + ((code >> 5) & 3) - 2) & 0x1F
+            g = (((old >> 5) & 0x3F) + ((code >> 2) & 7) - 4) & 0x3F
+            b = ((old & 0x1F) + (code & 3) - 2) & 0x1F
+            px = (r << 11) | (g << 5) | b
+            out[2 * i] = px & 0xFF
+            out[2 * i + 1] = px >> 8
+            i += 1
+        elif code < 0xC0:
+            i += (code & 0x3F) + 1
+        else:
+            n = (code & 0x3F) + 1
+            if i + n > pixels or pos + 2 * n > len(payload):
+                return None
+            out[2 * i:2 * (i + n)] = payload[pos:pos + 2 * n]
+            pos += 2 * n
+            i += n
+        if i > pixels:
+            return None
+    return bytes(out) if i == pixels else None
+
+
+class Frame:
+    def __init__(self, fields, payload):
+        (_, self.version, self.format, self.width, self.height, self.first_row,
+         self.num_rows, self.reference, self.timestamp, self.sequence, self.size, self.crc) = fields
+        self.payload = payload
+        self.pixels = None  # RGB565 bytes for colour frames, one byte per pixel for mono, None if it couldn't be decoded
+
+    def mono(self):
+        return self.format in (MONO, MONO_RLE)
+
+    def ratio(self):
+        """how much smaller the payload is than the same frame sent uncompressed"""
+        plain = payload_size(MONO if self.mono() else RGB565, self.width, self.num_rows)
+        return plain / max(self.size, 1)
+
+    def rgb(self):
+        """rows x width x 3 uint8 image of the band that was sent"""
+        if self.mono():
+            grey = np.frombuffer(self.pixels, np.uint8).reshape(self.num_rows, self.width)
+            return np.stack((grey, grey, grey), axis=-1)
+        px = np.frombuffer(self.pixels, '<u2').reshape(self.num_rows, self.width)  # low byte first
+        r = (px >> 11) << 3
+        g = ((px >> 5) & 0x3F) << 2
+        b = (px & 0x1F) << 3
+        return np.stack((r, g, b), axis=-1).astype(np.uint8)
+
+
+class Reader:
+    """pulls packets out of a byte stream, anything between them (printf text) is skipped"""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.bad = 0
+        self.skipped = 0
+        self.broken = 0  # delta frames that came without the frame they apply to
+        self.colour = None  # (sequence, pixels) of the last colour frame, what deltas apply to
+
+    def feed(self, data):
+        self.buf += data
+        frames = []
+        while True:
+            i = self.buf.find(MAGIC)
+            if i < 0:
+                keep = len(self.buf) - 3 if len(self.buf) > 3 else 0  # the magic could be split
+                self.skipped += keep
+                del self.buf[:keep]
+                return frames
+            self.skipped += i
+            del self.buf[:i]
+            if len(self.buf) < HEADER.size:
+                return frames
+            fields = HEADER.unpack_from(self.buf)
+            size = fields[10]
+            fmt = fields[2]
+            most = payload_size(fmt, fields[3], fields[6])
+            if fields[1] != VERSION or fmt >= len(FORMATS) or size > most or (fmt in (RGB565, MONO) and size != most):
+                self.bad += 1
+                del self.buf[:1]  # not a real header, look for the next magic
+                continue
+            if len(self.buf) < HEADER.size + size:
+                return frames
+            payload = bytes(self.buf[HEADER.size:HEADER.size + size])
+            crc = zlib.crc32(payload, zlib.crc32(self.buf[:HEADER.size - 4]))
+            if crc != fields[11]:
+                self.bad += 1
+                del self.buf[:1]
+                continue
+            frame = Frame(fields, payload)
+            self.decode(frame)
+            frames.append((frame, bytes(self.buf[:HEADER.size + size])))
+            del self.buf[:HEADER.size + size]
+
+
+    def decode(self, frame):
+        pixels = frame.width * frame.num_rows
+        if frame.format == MONO:
+            stride = (frame.width + 7) // 8
+            bits = np.unpackbits(np.frombuffer(frame.payload, np.uint8).reshape(frame.num_rows, stride), axis=1)
+            frame.pixels = (bits[:, :frame.width] * 255).astype(np.uint8).tobytes()
+        elif frame.format == MONO_RLE:
+            frame.pixels = decode_rle(frame.payload, frame.width, frame.num_rows)
+        elif frame.format == RGB565:
+            frame.pixels = frame.payload
+        elif (self.colour is not None and (self.colour[0] & 0xFFFF) == frame.reference
+              and len(self.colour[1]) == 2 * pixels):
+            frame.pixels = decode_delta(frame.payload, self.colour[1], pixels)
+        if frame.pixels is None:
+            self.broken += 1
+            if frame.format == RGB565_DELTA:
+                self.colour = None  # wait for the next raw frame
+        elif not frame.mono():
+            self.colour = (frame.sequence, frame.pixels)
+
+
+def read_file(path):
+    reader = Reader()
+    with open(path, 'rb') as f:
+        frames = [fr for fr, _ in reader.feed(f.read())]
+    return frames, reader
+
+
+def record(args):
+    import serial  # python3 -m pip install pyserial
+    ser = serial.Serial(args.port, timeout=0.1)
+    print('Opening port: ' + str(ser.name))
+    ser.write(b'z' if args.compress else b'u')
+    ser.write(b'm' if args.mono else b'v')  # start streaming
+    reader = Reader()
+    count = 0
+    total = 0
+    ratio = 0
+    start = time.time()
+    last_seq = None
+    gaps = 0
+    try:
+        with open(args.file, 'wb') as out:
+            while args.frames == 0 or count < args.frames:
+                data = ser.read(max(1, ser.in_waiting))
+                total += len(data)
+                for frame, raw in reader.feed(data):
+                    out.write(raw)  # only good packets end up in the recording
+                    if last_seq is not None and frame.sequence != last_seq + 1:
+                        gaps += 1
+                    last_seq = frame.sequence
+                    count += 1
+                    ratio += frame.ratio()
+                    if count % 30 == 0:
+                        elapsed = time.time() - start
+                        print('%d frames, %.1f fps, %.0f kB/s, compression %.2f'
+                              % (count, count / elapsed, total / elapsed / 1000, ratio / count))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        ser.write(b'x')  # stop streaming, the robot prints its encode times
+        time.sleep(0.2)
+        for line in ser.read(ser.in_waiting).split(b'\n'):
+            if line.startswith(b'link:'):
+                print(line.decode(errors='replace').strip())
+        ser.close()
+    elapsed = time.time() - start
+    print('%d frames in %.1f s (%.1f fps, %.0f kB/s), %d bad packets, %d camera frames not sent'
+          % (count, elapsed, count / elapsed, total / elapsed / 1000, reader.bad, gaps))
+
+
+def show(args):
+    import matplotlib.pyplot as plt
+    frames, reader = read_file(args.file)
+    frames = [fr for fr in frames if fr.pixels is not None]
+    if not frames:
+        print('no frames in ' + args.file)
+        return
+    index = [0]
+    fig, ax = plt.subplots()
+
+    def draw():
+        fr = frames[index[0]]
+        # put the band back where it was in the full image
+        image = np.zeros((fr.height, fr.width, 3), dtype=np.uint8)
+        image[fr.first_row:fr.first_row + fr.num_rows] = fr.rgb()
+        ax.clear()
+        ax.imshow(image, interpolation='nearest')
+        ax.set_title('frame %d  %.3f s  %s  (%d/%d, arrow keys)'
+                     % (fr.sequence, fr.timestamp / 1e6, FORMATS[fr.format], index[0] + 1, len(frames)))
+        ax.axis('off')
+        fig.canvas.draw_idle()
+
+    def key(event):
+        if event.key == 'right':
+            index[0] = min(index[0] + 1, len(frames) - 1)
+        elif event.key == 'left':
+            index[0] = max(index[0] - 1, 0)
+        draw()
+
+    fig.canvas.mpl_connect('key_press_event', key)
+    draw()
+    plt.show()
+
+
+def stats(args):
+    frames, reader = read_file(args.file)
+    if not frames:
+        print('no frames in ' + args.file)
+        return
+    seqs = [fr.sequence for fr in frames]
+    gaps = sum(1 for a, b in zip(seqs, seqs[1:]) if b != a + 1)
+    span = (frames[-1].timestamp - frames[0].timestamp) / 1e6
+    print('%d frames, %d bad packets, %d gaps, %d bytes skipped, %d could not be decoded' %
+          (len(frames), reader.bad, gaps, reader.skipped, reader.broken))
+    for fmt, name in enumerate(FORMATS):
+        some = [fr for fr in frames if fr.format == fmt]
+        if some:
+            print('  %-6s %5d frames, compression %.2f' % (name, len(some), sum(fr.ratio() for fr in some) / len(some)))
+    if span > 0:
+        print('%.1f s of camera time, %.1f fps recorded' % (span, (len(frames) - 1) / span))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='line follower camera recordings')
+    sub = parser.add_subparsers(dest='cmd', required=True)
+    p = sub.add_parser('record')
+    p.add_argument('port')
+    p.add_argument('file')
+    p.add_argument('--mono', action='store_true', help='1 bit thresholded frames, 16x less data')
+    p.add_argument('--compress', action='store_true', help='colour as deltas, 1 bit as run lengths')
+    p.add_argument('-n', '--frames', type=int, default=0, help='stop after this many frames (0 = Ctrl+C)')
+    p.set_defaults(func=record)
+    p = sub.add_parser('show')
+    p.add_argument('file')
+    p.set_defaults(func=show)
+    p = sub.add_parser('stats')
+    p.add_argument('file')
+    p.set_defaults(func=stats)
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,259 @@
+// cam_check.c
+// Host check of the camera capture in cam.c: synthetic VS/HS/PCLK byte streams go through the
+// model of the cam.pio state machine and the DMA (cam_stub.c), and the frames that come out of
+// getFrame() have to hold exactly the bytes that were sent, in the right buffers and order,
+// also across camera_set_size(). The register writes init_camera() makes have to be the ones the
+// old fixed-count init loops made.
+//
+//   cam_check            prints every failed check, exits 1 if there was one
+#include <stdio.h>
+#include <string.h>
+#include "cam.h"
+#include "cam_stub.h"
+
+static int checks = 0, failed = 0;
+
+#define CHECK(cond, ...) do { \
+    checks++; \
+    if (!(cond)) { \
+        failed++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// every byte of every test frame is different from the same byte in the frames around it
+static uint8_t frame_byte(int frame, int row, int i) {
+    return (uint8_t)(frame * 37 + row * 11 + i * 3);
+}
+
+static void bus(bool vs, bool hs, bool pclk, uint8_t data) {
+    sim_cam_bus(((uint32_t)data << D0) | ((uint32_t)vs << VS) | ((uint32_t)hs << HS) | ((uint32_t)pclk << PCLK));
+}
+
+// PCLK keeps running through the blanking, only HS says when the bytes count
+static void blanking(bool vs, int clocks) {
+    int i;
+    for (i = 0; i < clocks; i++) {
+        bus(vs, false, false, 0xEE);
+        bus(vs, false, true, 0xEE);
+    }
+}
+
+static void send_rows(int frame, int width, int fromRow, int toRow) {
+    int row, i;
+    for (row = fromRow; row < toRow; row++) {
+        blanking(false, 3);
+        for (i = 0; i < width * 2; i++) {
+            uint8_t b = frame_byte(frame, row, i);
+            bus(false, true, false, b);
+            bus(false, true, true, b);
+        }
+        bus(false, false, false, 0xEE);
+    }
+}
+
+// a VS pulse and then the whole image
+static void send_frame(int frame, int width, int height) {
+    blanking(true, 4);
+    blanking(false, 4);
+    send_rows(frame, width, 0, height);
+    sim_advance_us(33333);
+}
+
+// the frame has to hold rows firstRow.. of the test frame, nothing else
+static bool frame_matches(const cameraFrame_t *f, int frame) {
+    int row, i;
+    for (row = 0; row < f->numRows; row++) {
+        for (i = 0; i < f->width * 2; i++) {
+            if (f->data[row * f->width * 2 + i] != frame_byte(frame, f->firstRow + row, i)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// what init_camera() wrote before OV7670_write_table(): reset, clock, the two tables up to their
+// end marker (the old loops also wrote the marker to register 0xff), then the 80x60 window with
+// the values the old inline code worked out
+static int baseline_init(uint8_t seq[][2]) {
+    static const uint8_t window[][2] = {
+        {OV7670_REG_COM3, OV7670_COM3_DCWEN}, {OV7670_REG_COM14, 0x1B}, {OV7670_REG_SCALING_DCWCTR, 0x33},
+        {OV7670_REG_SCALING_PCLK_DIV, 0xF3}, {OV7670_REG_SCALING_XSC, 0x20}, {OV7670_REG_SCALING_YSC, 0x20},
+        {OV7670_REG_HSTART, 26}, {OV7670_REG_HSTOP, 8}, {OV7670_REG_HREF, 0x12},
+        {OV7670_REG_VSTART, 3}, {OV7670_REG_VSTOP, 123}, {OV7670_REG_VREF, 0}, {OV7670_REG_SCALING_PCLK_DELAY, 2},
+    };
+    uint8_t shadow[256] = {0};
+    int n = 0, i;
+    seq[n][0] = OV7670_REG_COM7; seq[n++][1] = OV7670_COM7_RESET;
+    seq[n][0] = OV7670_REG_CLKRC; seq[n++][1] = 1;
+    seq[n][0] = OV7670_REG_DBLV; seq[n++][1] = 0;
+    for (i = 0; i < 92; i++) {
+        if (OV7670_init[i][0] != 0xff) {
+            seq[n][0] = OV7670_init[i][0]; seq[n++][1] = OV7670_init[i][1];
+        }
+    }
+    for (i = 0; i < 12; i++) {
+        if (OV7670_rgb[i][0] != 0xff) {
+            seq[n][0] = OV7670_rgb[i][0]; seq[n++][1] = OV7670_rgb[i][1];
+        }
+    }
+    for (i = 0; i < n; i++) {
+        shadow[seq[i][0]] = seq[i][1];
+    }
+    for (i = 0; i < (int)(sizeof(window) / sizeof(window[0])); i++) {
+        seq[n][0] = window[i][0];
+        seq[n][1] = window[i][1];
+        if (window[i][0] == OV7670_REG_SCALING_XSC || window[i][0] == OV7670_REG_SCALING_YSC) {
+            seq[n][1] |= shadow[window[i][0]] & 0x80; // the test pattern bit is read back and kept
+        }
+        n++;
+    }
+    return n;
+}
+
+static void check_init(void) {
+    uint8_t expected[SIM_CAM_MAX_WRITES][2];
+    const uint8_t (*writes)[2];
+    int n = baseline_init(expected);
+
+    sim_cam_writes_clear();
+    init_camera_pins();
+    int got = sim_cam_writes(&writes);
+    CHECK(got == n, "%d register writes, the old init made %d", got, n);
+    int i;
+    for (i = 0; i < got && i < n; i++) {
+        if (writes[i][0] != expected[i][0] || writes[i][1] != expected[i][1]) {
+            CHECK(false, "write %d: reg 0x%02X = 0x%02X, the old init wrote reg 0x%02X = 0x%02X",
+                  i, writes[i][0], writes[i][1], expected[i][0], expected[i][1]);
+            break;
+        }
+    }
+    CHECK(getCameraInitTime() < 100000, "init took %u us", getCameraInitTime());
+    printf("init: %d register writes, %u ms\n", got, getCameraInitTime() / 1000);
+}
+
+static void check_capture(void) {
+    int w = IMAGESIZEX, h = IMAGESIZEY;
+    cameraFrame_t f, held;
+
+    CHECK(getImageWidth() == w && getImageHeight() == h, "image %dx%d", getImageWidth(), getImageHeight());
+
+    // single capture, armed in the middle of a frame: the partial frame must not count
+    setSaveImage(1);
+    CHECK(sim_pio_tx_dropped() == 0, "%u arming words lost, the state machine can't start", sim_pio_tx_dropped());
+    send_rows(0, w, h / 2, h);
+    CHECK(getSaveImage() == 1, "capture finished on half a frame");
+    send_frame(1, w, h);
+    CHECK(getSaveImage() == 0, "capture still waiting after a whole frame");
+    CHECK(getPixelCount() == (uint32_t)(w * h * 2), "%u bytes captured", getPixelCount());
+    CHECK(getHSCount() == (uint32_t)h, "%u rows captured", getHSCount());
+
+    // continuous: frames come out in order with the bytes that were sent
+    startContinuousCapture();
+    CHECK(!getFrame(&f), "frame before any was sent");
+    send_frame(2, w, h);
+    CHECK(getFrame(&f), "no frame after sending one");
+    CHECK(f.firstRow == 0 && f.numRows == h && f.width == w, "frame rows %d+%d width %d", f.firstRow, f.numRows, f.width);
+    CHECK(frame_matches(&f, 2), "frame 2 bytes differ");
+    uint32_t firstSeq = f.sequence;
+    held = f;
+
+    // the held buffer is left alone: the next frame fills the other one, then capture waits
+    send_frame(3, w, h);
+    send_frame(4, w, h);
+    CHECK(frame_matches(&held, 2), "held frame was overwritten");
+    CHECK(getFrame(&f), "no frame after the held one");
+    CHECK(frame_matches(&f, 3), "expected frame 3");
+    CHECK(f.sequence == firstSeq + 1, "sequence %u after %u", f.sequence, firstSeq);
+    CHECK(getDroppedFrames() == 0, "%u dropped while capture waited", getDroppedFrames());
+
+    // nobody picks up a frame: the older one is dropped and the newest handed out
+    releaseFrame();
+    send_frame(5, w, h);
+    send_frame(6, w, h);
+    CHECK(getFrame(&f), "no frame after two were sent");
+    CHECK(frame_matches(&f, 6), "expected the newest frame");
+    CHECK(getDroppedFrames() == 1, "%u dropped, expected 1", getDroppedFrames());
+    releaseFrame();
+
+    // region of interest: only rows 10..59 land in the buffer, packed at the start
+    setCaptureRows(10, h - 10);
+    int frame = 7, tries;
+    for (tries = 0; tries < 3; tries++, frame++) {
+        send_frame(frame, w, h);
+        if (getFrame(&f) && f.numRows == h - 10) {
+            break;
+        }
+        releaseFrame();
+    }
+    CHECK(tries < 3, "region of interest never took effect");
+    CHECK(f.firstRow == 10 && f.numRows == h - 10, "roi frame rows %d+%d", f.firstRow, f.numRows);
+    CHECK(frame_matches(&f, frame), "roi frame bytes differ");
+    releaseFrame();
+
+    // restarted in the middle of a frame: the rest of it is skipped, the next one is whole
+    stopContinuousCapture();
+    send_rows(20, w, 0, h / 2);
+    startContinuousCapture();
+    send_rows(20, w, h / 2, h);
+    CHECK(!getFrame(&f), "frame from the tail of an image");
+    send_frame(21, w, h);
+    CHECK(getFrame(&f) && frame_matches(&f, 21), "expected frame 21 after the restart");
+    releaseFrame();
+    stopContinuousCapture();
+
+    CHECK(sim_pio_tx_dropped() == 0, "%u arming words lost", sim_pio_tx_dropped());
+    printf("capture: %u frames, %u dropped, %u bytes shifted in\n",
+           getFrameCount(), getDroppedFrames(), sim_pio_bytes_in());
+}
+
+// camera_set_size() must not free the buffers under a frame the control loop still holds
+static void check_resize(void) {
+    cameraFrame_t f, held;
+    int frame = 30;
+
+    startContinuousCapture();
+    send_frame(frame, IMAGESIZEX, IMAGESIZEY);
+    CHECK(getFrame(&held), "no frame to hold");
+    uint64_t t0 = time_us_64();
+    CHECK(!camera_set_size(OV7670_SIZE_DIV16), "resized with a frame held");
+    CHECK(time_us_64() - t0 >= CAM_RESIZE_TIMEOUT_US, "gave up after %llu us", (unsigned long long)(time_us_64() - t0));
+    CHECK(getImageWidth() == IMAGESIZEX && getImageHeight() == IMAGESIZEY, "size changed to %dx%d",
+          getImageWidth(), getImageHeight());
+
+    // the capture carries on at the old size, in the buffer that isn't held
+    send_frame(frame + 1, IMAGESIZEX, IMAGESIZEY);
+    CHECK(frame_matches(&held, frame), "held frame overwritten after the failed resize");
+    CHECK(getFrame(&f) && frame_matches(&f, ++frame), "capture didn't resume after the failed resize");
+    releaseFrame();
+
+    static const struct { OV7670_size size; int width, height; } sizes[] = {
+        {OV7670_SIZE_DIV16, 40, 30}, {OV7670_SIZE_DIV4, 160, 120}, {OV7670_SIZE_DIV8, 80, 60},
+    };
+    int i;
+    for (i = 0; i < 3; i++) {
+        int w = sizes[i].width, h = sizes[i].height;
+        CHECK(camera_set_size(sizes[i].size), "resize to %dx%d failed", w, h);
+        CHECK(getImageWidth() == w && getImageHeight() == h, "size %dx%d, expected %dx%d",
+              getImageWidth(), getImageHeight(), w, h);
+        CHECK(!getFrame(&f), "old frame handed out after the resize");
+        send_frame(++frame, w, h);
+        CHECK(getFrame(&f), "no frame at %dx%d", w, h);
+        CHECK(f.width == w && f.firstRow == 0 && f.numRows == h, "frame %d wide, rows %d+%d", f.width, f.firstRow, f.numRows);
+        CHECK(frame_matches(&f, frame), "frame bytes differ at %dx%d", w, h);
+        releaseFrame();
+    }
+    CHECK(!camera_set_size(OV7670_SIZE_DIV16 + 1), "accepted a size that doesn't exist");
+    stopContinuousCapture();
+}
+
+int main(void) {
+    check_init();
+    check_capture();
+    check_resize();
+    printf("%d checks, %d failed\n", checks, failed);
+    return failed == 0 ? 0 : 1;
+}
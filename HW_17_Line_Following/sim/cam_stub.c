@@ -0,0 +1,553 @@
+// pico SDK calls made by cam.c, see cam_stub.h
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "ov7670.h"
+#include "cam.pio.h"
+#include "cam_stub.h"
+
+// ---- time, gpio and interrupts ----
+
+static uint64_t simTimeUs = 0;
+
+uint64_t time_us_64(void) {
+    return simTimeUs;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)simTimeUs;
+}
+
+void sleep_ms(uint32_t ms) {
+    simTimeUs += (uint64_t)ms * 1000;
+}
+
+void tight_loop_contents(void) {
+    simTimeUs++; // a spin loop has to see time pass or it never times out
+}
+
+void sim_advance_us(uint64_t us) {
+    simTimeUs += us;
+}
+
+void gpio_init(uint gpio) {
+    (void) gpio;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    (void) gpio;
+    (void) out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    (void) gpio;
+    (void) value;
+}
+
+void gpio_pull_up(uint gpio) {
+    (void) gpio;
+}
+
+static irq_handler_t dmaHandler = NULL;
+static bool dmaIrqEnabled = false;
+static int irqDisabled = 0;  // save_and_disable_interrupts() nesting
+static bool dmaIrqPending = false;
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+    (void) order_priority;
+    if (num == DMA_IRQ_0) {
+        dmaHandler = handler;
+    }
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    if (num == DMA_IRQ_0) {
+        dmaIrqEnabled = enabled;
+    }
+}
+
+// the handler runs straight away, or once interrupts are back on
+static void raise_dma_irq(void) {
+    if (irqDisabled > 0 || !dmaIrqEnabled || dmaHandler == NULL) {
+        dmaIrqPending = true;
+        return;
+    }
+    dmaIrqPending = false;
+    dmaHandler();
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    irqDisabled++;
+    return 0;
+}
+
+void restore_interrupts(uint32_t status) {
+    (void) status;
+    if (irqDisabled > 0 && --irqDisabled == 0 && dmaIrqPending) {
+        raise_dma_irq();
+    }
+}
+
+static spin_lock_t spinLocks[32];
+static int spinLocksClaimed = 0;
+
+int spin_lock_claim_unused(bool required) {
+    (void) required;
+    return spinLocksClaimed < 32 ? spinLocksClaimed++ : -1;
+}
+
+spin_lock_t *spin_lock_init(unsigned int lock_num) {
+    spinLocks[lock_num] = 0;
+    return &spinLocks[lock_num];
+}
+
+uint32_t spin_lock_blocking(spin_lock_t *lock) {
+    uint32_t irq = save_and_disable_interrupts();
+    *lock = 1;
+    return irq;
+}
+
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq) {
+    *lock = 0;
+    restore_interrupts(saved_irq);
+}
+
+// ---- OV7670 on i2c1 ----
+
+i2c_inst_t sim_i2c0 = {0}, sim_i2c1 = {1};
+
+static uint8_t camRegs[256];
+static uint8_t camRegPointer = 0;
+static uint8_t camWrites[SIM_CAM_MAX_WRITES][2]; // every register write in order, for sim_cam_writes()
+static int camWriteCount = 0;
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    (void) i2c;
+    camRegs[OV7670_REG_PID] = 0x76;
+    camRegs[OV7670_REG_VER] = 0x73;
+    return baudrate;
+}
+
+// one byte sets the register pointer for a read, two write a register
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    (void) nostop;
+    if (i2c != i2c1 || addr != OV7670_ADDR || len < 1) {
+        return -1;
+    }
+    camRegPointer = src[0];
+    if (len >= 2) {
+        if (camWriteCount < SIM_CAM_MAX_WRITES) {
+            camWrites[camWriteCount][0] = src[0];
+            camWrites[camWriteCount][1] = src[1];
+        }
+        camWriteCount++;
+        if (src[0] != OV7670_REG_PID && src[0] != OV7670_REG_VER) {
+            camRegs[src[0]] = src[1];
+        }
+    }
+    return (int)len;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    (void) nostop;
+    if (i2c != i2c1 || addr != OV7670_ADDR) {
+        return -1;
+    }
+    size_t i;
+    for (i = 0; i < len; i++) {
+        dst[i] = camRegs[camRegPointer++];
+    }
+    return (int)len;
+}
+
+int sim_cam_writes(const uint8_t (**writes)[2]) {
+    *writes = camWrites;
+    return camWriteCount < SIM_CAM_MAX_WRITES ? camWriteCount : SIM_CAM_MAX_WRITES;
+}
+
+void sim_cam_writes_clear(void) {
+    camWriteCount = 0;
+}
+
+// ---- DMA ----
+
+typedef struct simDma {
+    bool claimed;
+    bool busy;
+    bool irq0Enabled;
+    bool irq0Status;
+    dma_channel_config config;
+    uint32_t *write;
+} simDma_t;
+
+static simDma_t dmaChannels[SIM_NUM_DMA];
+static dma_channel_hw_t dmaHw[SIM_NUM_DMA];
+
+int dma_claim_unused_channel(bool required) {
+    (void) required;
+    int i;
+    for (i = 0; i < SIM_NUM_DMA; i++) {
+        if (!dmaChannels[i].claimed) {
+            dmaChannels[i].claimed = true;
+            return i;
+        }
+    }
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void) channel;
+    dma_channel_config c = {DMA_SIZE_32, true, false, 0x3f};
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    c->size = size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->read_increment = incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->write_increment = incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    c->dreq = dreq;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger) {
+    (void) read_addr;
+    dmaChannels[channel].config = *config;
+    dmaChannels[channel].write = (uint32_t *)write_addr;
+    dmaHw[channel].transfer_count = transfer_count;
+    dmaChannels[channel].busy = trigger && transfer_count > 0;
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger) {
+    dmaChannels[channel].write = (uint32_t *)write_addr;
+    if (trigger) {
+        dmaChannels[channel].busy = dmaHw[channel].transfer_count > 0;
+    }
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+    dmaHw[channel].transfer_count = trans_count;
+    if (trigger) {
+        dmaChannels[channel].busy = trans_count > 0;
+    }
+}
+
+void dma_channel_abort(uint channel) {
+    dmaChannels[channel].busy = false;
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) {
+    dmaChannels[channel].irq0Enabled = enabled;
+}
+
+bool dma_channel_get_irq0_status(uint channel) {
+    return dmaChannels[channel].irq0Status;
+}
+
+void dma_channel_acknowledge_irq0(uint channel) {
+    dmaChannels[channel].irq0Status = false;
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(uint channel) {
+    return &dmaHw[channel];
+}
+
+// ---- PIO: the cam_capture program, one state per wait/pull/in in cam.pio ----
+
+#define SIM_DREQ_PIO0_RX0 4
+
+typedef enum {
+    PIO_PULL_SKIP,      // pull block, mov x, osr
+    PIO_PULL_ROWS,      // pull block, mov y, osr
+    PIO_PULL_BYTES,     // pull block
+    PIO_WAIT_VS_HIGH,
+    PIO_WAIT_VS_LOW,
+    PIO_SKIP,           // jmp x-- skip_row
+    PIO_SKIP_HS_HIGH,
+    PIO_SKIP_HS_LOW,
+    PIO_ROW,            // mov x, osr
+    PIO_ROW_HS_HIGH,
+    PIO_BYTE_PCLK_LOW,
+    PIO_BYTE_PCLK_HIGH, // then in pins, 8 and jmp x-- byte
+    PIO_BYTE_PUSH,      // autopush waiting for room in the RX fifo
+    PIO_ROW_HS_LOW,     // then jmp y-- row
+} simPioState_t;
+
+typedef struct simSm {
+    bool claimed;
+    bool enabled;
+    pio_sm_config config;
+    simPioState_t state;
+    uint32_t x, y, osr, isr;
+    int isrBits;
+    uint32_t tx[2*SIM_PIO_FIFO_DEPTH];
+    int txCount;
+    uint32_t rx[2*SIM_PIO_FIFO_DEPTH];
+    int rxCount;
+} simSm_t;
+
+pio_hw_t sim_pio0;
+static simSm_t pioSm[4];
+static bool programLoaded = false;
+static uint32_t txDropped = 0;
+static uint32_t bytesIn = 0;
+
+static const uint16_t camCaptureInstructions[1] = {0};
+const pio_program_t cam_capture_program = {camCaptureInstructions, 1, -1};
+
+pio_sm_config pio_get_default_sm_config(void) {
+    pio_sm_config c = {0, true, false, 32, PIO_FIFO_JOIN_NONE, 1.0f};
+    return c;
+}
+
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base) {
+    c->in_base = in_base;
+}
+
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold) {
+    c->in_shift_right = shift_right;
+    c->autopush = autopush;
+    c->push_threshold = push_threshold;
+}
+
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) {
+    c->join = join;
+}
+
+void sm_config_set_clkdiv(pio_sm_config *c, float div) {
+    c->clkdiv = div;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+    (void) pio;
+    (void) program;
+    programLoaded = true;
+    return 0;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    (void) pio;
+    (void) required;
+    int i;
+    for (i = 0; i < 4; i++) {
+        if (!pioSm[i].claimed) {
+            pioSm[i].claimed = true;
+            return i;
+        }
+    }
+    return -1;
+}
+
+int pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config) {
+    (void) pio;
+    (void) initial_pc;
+    pioSm[sm].config = *config;
+    pioSm[sm].enabled = false;
+    pio_sm_clear_fifos(pio, sm);
+    pio_sm_restart(pio, sm);
+    pioSm[sm].state = PIO_PULL_SKIP;
+    return 0;
+}
+
+int pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) {
+    (void) pio;
+    (void) sm;
+    (void) pin_base;
+    (void) pin_count;
+    (void) is_out;
+    return 0;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    (void) pio;
+    pioSm[sm].enabled = enabled;
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+    (void) pio;
+    pioSm[sm].txCount = 0;
+    pioSm[sm].rxCount = 0;
+}
+
+void pio_sm_restart(PIO pio, uint sm) {
+    (void) pio;
+    pioSm[sm].isr = 0;
+    pioSm[sm].isrBits = 0;
+}
+
+// the only instruction cam.c executes is the jmp back to the top of the program
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+    (void) pio;
+    (void) instr;
+    pioSm[sm].state = PIO_PULL_SKIP;
+}
+
+uint pio_encode_jmp(uint addr) {
+    return addr;
+}
+
+static int tx_depth(const simSm_t *s) {
+    if (s->config.join == PIO_FIFO_JOIN_TX) return 2*SIM_PIO_FIFO_DEPTH;
+    if (s->config.join == PIO_FIFO_JOIN_RX) return 0;
+    return SIM_PIO_FIFO_DEPTH;
+}
+
+static int rx_depth(const simSm_t *s) {
+    if (s->config.join == PIO_FIFO_JOIN_RX) return 2*SIM_PIO_FIFO_DEPTH;
+    if (s->config.join == PIO_FIFO_JOIN_TX) return 0;
+    return SIM_PIO_FIFO_DEPTH;
+}
+
+// like the hardware, a put into a full TX fifo is lost
+void pio_sm_put(PIO pio, uint sm, uint32_t data) {
+    (void) pio;
+    simSm_t *s = &pioSm[sm];
+    if (s->txCount >= tx_depth(s)) {
+        txDropped++;
+        return;
+    }
+    s->tx[s->txCount++] = data;
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+    (void) pio;
+    return SIM_DREQ_PIO0_RX0 + sm - (is_tx ? 4 : 0);
+}
+
+uint32_t sim_pio_tx_dropped(void) {
+    return txDropped;
+}
+
+uint32_t sim_pio_bytes_in(void) {
+    return bytesIn;
+}
+
+// channels paced by this state machine's RX fifo take words until it is empty or they are done
+static void service_dma(uint sm) {
+    simSm_t *s = &pioSm[sm];
+    int ch;
+    for (ch = 0; ch < SIM_NUM_DMA; ch++) {
+        simDma_t *d = &dmaChannels[ch];
+        if (!d->busy || d->config.dreq != SIM_DREQ_PIO0_RX0 + sm) {
+            continue;
+        }
+        while (s->rxCount > 0 && d->busy) {
+            *d->write = s->rx[0];
+            if (d->config.write_increment) d->write++;
+            s->rxCount--;
+            memmove(s->rx, s->rx + 1, s->rxCount * sizeof(s->rx[0]));
+            if (--dmaHw[ch].transfer_count == 0) {
+                d->busy = false;
+                if (d->irq0Enabled) {
+                    d->irq0Status = true;
+                    raise_dma_irq(); // may restart this state machine and channel
+                }
+            }
+        }
+    }
+}
+
+static bool pin(const simSm_t *s, uint32_t pins, int offset) {
+    return (pins >> (s->config.in_base + offset)) & 1;
+}
+
+// pull block: false while the TX fifo is empty
+static bool pull(simSm_t *s) {
+    if (s->txCount == 0) {
+        return false;
+    }
+    s->osr = s->tx[0];
+    s->txCount--;
+    memmove(s->tx, s->tx + 1, s->txCount * sizeof(s->tx[0]));
+    return true;
+}
+
+void sim_cam_bus(uint32_t pins) {
+    uint sm;
+    for (sm = 0; sm < 4; sm++) {
+        simSm_t *s = &pioSm[sm];
+        // run until an instruction stalls on this sample. The DMA interrupt can restart the
+        // state machine in the middle, so the state is always read back from s
+        bool running = true;
+        while (running && s->enabled && programLoaded) {
+            switch (s->state) {
+            case PIO_PULL_SKIP:
+                if ((running = pull(s))) { s->x = s->osr; s->state = PIO_PULL_ROWS; }
+                break;
+            case PIO_PULL_ROWS:
+                if ((running = pull(s))) { s->y = s->osr; s->state = PIO_PULL_BYTES; }
+                break;
+            case PIO_PULL_BYTES:
+                if ((running = pull(s))) s->state = PIO_WAIT_VS_HIGH;
+                break;
+            case PIO_WAIT_VS_HIGH:
+                if ((running = pin(s, pins, cam_capture_VS_OFFSET))) s->state = PIO_WAIT_VS_LOW;
+                break;
+            case PIO_WAIT_VS_LOW:
+                if ((running = !pin(s, pins, cam_capture_VS_OFFSET))) s->state = PIO_SKIP;
+                break;
+            case PIO_SKIP:
+                s->state = (s->x != 0) ? PIO_SKIP_HS_HIGH : PIO_ROW;
+                s->x--;
+                break;
+            case PIO_SKIP_HS_HIGH:
+                if ((running = pin(s, pins, cam_capture_HS_OFFSET))) s->state = PIO_SKIP_HS_LOW;
+                break;
+            case PIO_SKIP_HS_LOW:
+                if ((running = !pin(s, pins, cam_capture_HS_OFFSET))) s->state = PIO_SKIP;
+                break;
+            case PIO_ROW:
+                s->x = s->osr;
+                s->state = PIO_ROW_HS_HIGH;
+                break;
+            case PIO_ROW_HS_HIGH:
+                if ((running = pin(s, pins, cam_capture_HS_OFFSET))) s->state = PIO_BYTE_PCLK_LOW;
+                break;
+            case PIO_BYTE_PCLK_LOW:
+                if ((running = !pin(s, pins, cam_capture_PCLK_OFFSET))) s->state = PIO_BYTE_PCLK_HIGH;
+                break;
+            case PIO_BYTE_PCLK_HIGH:
+                if (!(running = pin(s, pins, cam_capture_PCLK_OFFSET))) break;
+                {
+                    uint32_t data = (pins >> s->config.in_base) & 0xFF;
+                    s->isr = s->config.in_shift_right ? (s->isr >> 8) | (data << 24) : (s->isr << 8) | data;
+                    s->isrBits += 8;
+                    bytesIn++;
+                }
+                s->state = PIO_BYTE_PUSH;
+                // fall through
+            case PIO_BYTE_PUSH:
+                if (s->config.autopush && s->isrBits >= (int)s->config.push_threshold) {
+                    if (s->rxCount >= rx_depth(s)) {
+                        running = false; // stalls until the DMA makes room
+                        break;
+                    }
+                    s->rx[s->rxCount++] = s->isr;
+                    s->isr = 0;
+                    s->isrBits = 0;
+                }
+                s->state = (s->x != 0) ? PIO_BYTE_PCLK_LOW : PIO_ROW_HS_LOW;
+                s->x--;
+                service_dma(sm);
+                break;
+            case PIO_ROW_HS_LOW:
+                if (!(running = !pin(s, pins, cam_capture_HS_OFFSET))) break;
+                s->state = (s->y != 0) ? PIO_ROW : PIO_PULL_SKIP; // .wrap back to the pulls
+                s->y--;
+                break;
+            }
+        }
+        service_dma(sm);
+    }
+}
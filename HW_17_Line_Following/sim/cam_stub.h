@@ -0,0 +1,30 @@
+// cam_stub.h
+// Host stand-ins for the SDK calls cam.c makes, with enough behind them to capture frames:
+// a model of the cam.pio state machine stepped one bus sample at a time, a DMA channel that
+// drains its RX fifo into memory and raises DMA_IRQ_0, and an OV7670 register file on i2c1
+// that logs every write.
+#ifndef CAM_STUB_H
+#define CAM_STUB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// one sample of the camera bus as the GPIO pins would read it: D0-D7, VS, HS and PCLK at
+// their cam.h pins. The state machine runs until it has to wait for a different level
+void sim_cam_bus(uint32_t pins);
+
+// words the cpu put while the TX fifo was full, the state machine never saw them
+uint32_t sim_pio_tx_dropped(void);
+
+// bytes the state machine has shifted in since boot
+uint32_t sim_pio_bytes_in(void);
+
+void sim_advance_us(uint64_t us);
+
+// register writes the OV7670 got over i2c1, {register, value} in order. Reads only set the
+// register pointer and aren't in the log. Keeps the first SIM_CAM_MAX_WRITES
+#define SIM_CAM_MAX_WRITES 512
+int sim_cam_writes(const uint8_t (**writes)[2]);
+void sim_cam_writes_clear(void);
+
+#endif
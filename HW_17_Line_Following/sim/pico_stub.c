@@ -0,0 +1,46 @@
+// pico SDK calls made by motor.c, recorded instead of touching hardware
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/pwm.h"
+
+#define SIM_NUM_GPIO 48
+#define SIM_NUM_SLICES 12
+
+static uint16_t sliceWrap[SIM_NUM_SLICES];
+static bool sliceEnabled[SIM_NUM_SLICES];
+static uint16_t gpioLevel[SIM_NUM_GPIO];
+
+void gpio_set_function(uint gpio, gpio_function_t fn) {
+    (void) gpio;
+    (void) fn;
+}
+
+uint pwm_gpio_to_slice_num(uint gpio) {
+    return (gpio >> 1) % SIM_NUM_SLICES; // two pins (A and B) per slice
+}
+
+void pwm_set_clkdiv(uint slice_num, float divider) {
+    (void) slice_num;
+    (void) divider;
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap) {
+    sliceWrap[slice_num % SIM_NUM_SLICES] = wrap;
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled) {
+    sliceEnabled[slice_num % SIM_NUM_SLICES] = enabled;
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level) {
+    gpioLevel[gpio % SIM_NUM_GPIO] = level;
+}
+
+float sim_pwm_duty(uint gpio) {
+    uint slice = pwm_gpio_to_slice_num(gpio);
+    if (!sliceEnabled[slice]) {
+        return 0;
+    }
+    float duty = (float)gpioLevel[gpio % SIM_NUM_GPIO] / ((float)sliceWrap[slice] + 1);
+    return duty > 1 ? 1 : duty; // level past wrap means always high
+}
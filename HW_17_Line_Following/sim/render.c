@@ -0,0 +1,122 @@
+// render.c
+// ray cast every pixel to the floor once, then each frame is only a rotation and a lookup
+#include <stdlib.h>
+#include <math.h>
+#include "render.h"
+
+#define FLOOR_LEVEL 0.15f // brightness of the bare floor, the tape is 1
+
+void camera_init(camera_t *cam, int width, int height, float height_m, float forward_m, float pitch_deg, float hfov_deg) {
+    cam->width = width;
+    cam->height = height;
+    cam->height_m = height_m;
+    cam->forward_m = forward_m;
+    cam->pitch = pitch_deg * (float)M_PI / 180;
+    cam->hfov = hfov_deg * (float)M_PI / 180;
+    cam->noise = 0;
+
+    int n = RENDER_SUPERSAMPLE;
+    cam->ground = malloc(sizeof(float) * 2 * width * height * n * n);
+    float f = (width / 2.0f) / tanf(cam->hfov / 2); // focal length in pixels, square pixels
+    float cp = cosf(cam->pitch), sp = sinf(cam->pitch);
+    int u, v, s;
+    float *g = cam->ground;
+    for (v = 0; v < height; v++) {
+        for (u = 0; u < width; u++) {
+            for (s = 0; s < n*n; s++) {
+                // ray through the sample, camera axes: forward, right, down
+                float right = (u + (s % n + 0.5f) / n - width / 2.0f) / f;
+                float down = (v + (s / n + 0.5f) / n - height / 2.0f) / f;
+                // tilt the camera down by pitch
+                float fwd = cp - down * sp;
+                float dn = sp + down * cp;
+                if (dn <= 1e-4f) {
+                    *g++ = NAN;
+                    *g++ = NAN;
+                } else {
+                    float t = height_m / dn;
+                    *g++ = fwd * t;
+                    *g++ = -right * t; // left is positive in robot axes
+                }
+            }
+        }
+    }
+}
+
+void camera_free(camera_t *cam) {
+    free(cam->ground);
+    cam->ground = NULL;
+}
+
+// roughly gaussian, sum of uniform samples
+static float noise_sample(void) {
+    return ((float)rand() + rand() + rand() - 1.5f * RAND_MAX) / RAND_MAX * 2;
+}
+
+// how much of a pixel is tape, 0 to 1, and the share of its samples that hit the floor.
+// g points at the pixel's samples in cam->ground, (lx, ly) is the lens and (c, s) the heading
+static float pixel_tape(const track_t *track, const float *g,
+                        float lx, float ly, float c, float s, float *onFloor) {
+    int n2 = RENDER_SUPERSAMPLE * RENDER_SUPERSAMPLE;
+    float sum = 0;
+    int k, hit = 0;
+    for (k = 0; k < n2; k++, g += 2) {
+        if (isnan(g[0])) continue; // above the horizon
+        float gx = lx + g[0] * c - g[1] * s;
+        float gy = ly + g[0] * s + g[1] * c;
+        sum += track_sample(track, gx, gy);
+        hit++;
+    }
+    *onFloor = (float)hit / n2;
+    return sum / n2;
+}
+
+void render_frame(const camera_t *cam, const track_t *track, const robot_t *robot,
+                  uint8_t *data, int firstRow, int numRows) {
+    int n2 = RENDER_SUPERSAMPLE * RENDER_SUPERSAMPLE;
+    float c = cosf(robot->heading), s = sinf(robot->heading);
+    float lx = robot->x + cam->forward_m * c, ly = robot->y + cam->forward_m * s;
+    int u, v;
+    for (v = firstRow; v < firstRow + numRows; v++) {
+        const float *g = &cam->ground[2 * n2 * v * cam->width];
+        uint8_t *p = &data[2 * (v - firstRow) * cam->width];
+        for (u = 0; u < cam->width; u++, g += 2 * n2) {
+            float onFloor;
+            float tape = pixel_tape(track, g, lx, ly, c, s, &onFloor);
+            float b = FLOOR_LEVEL * onFloor + (1 - FLOOR_LEVEL) * tape;
+            if (cam->noise > 0) b += cam->noise * noise_sample();
+            if (b < 0) b = 0;
+            if (b > 1) b = 1;
+            // gray in RGB565, low byte first like the camera sends it
+            uint16_t r5 = (uint16_t)(b * 31 + 0.5f), g6 = (uint16_t)(b * 63 + 0.5f);
+            uint16_t px = (uint16_t)((r5 << 11) | (g6 << 5) | r5);
+            *p++ = px & 0xFF;
+            *p++ = px >> 8;
+        }
+    }
+}
+
+int render_line_truth(const camera_t *cam, const track_t *track, const robot_t *robot,
+                      const int *rows, int nrows, float *centers) {
+    int n2 = RENDER_SUPERSAMPLE * RENDER_SUPERSAMPLE;
+    float c = cosf(robot->heading), s = sinf(robot->heading);
+    float lx = robot->x + cam->forward_m * c, ly = robot->y + cam->forward_m * s;
+    int i, u, found = 0;
+    for (i = 0; i < nrows; i++) {
+        const float *g = &cam->ground[2 * n2 * rows[i] * cam->width];
+        float sum = 0, sumPos = 0;
+        for (u = 0; u < cam->width; u++, g += 2 * n2) {
+            float onFloor;
+            float tape = pixel_tape(track, g, lx, ly, c, s, &onFloor);
+            sum += tape;
+            sumPos += tape * u;
+        }
+        if (sum < RENDER_TRUTH_MIN_TAPE) {
+            centers[i] = NAN;
+        } else {
+            centers[i] = sumPos / sum;
+            found++;
+        }
+    }
+    return found;
+}
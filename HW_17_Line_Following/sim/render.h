@@ -0,0 +1,39 @@
+// render.h
+// Synthetic OV7670 frames: a pinhole camera on the robot looking down at the track,
+// written as little endian RGB565 the same way the camera DMA fills its buffer.
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdint.h>
+#include "track.h"
+#include "robot.h"
+
+#define RENDER_SUPERSAMPLE 2 // 2x2 ground samples per pixel, softens the tape edges like the real lens
+#define RENDER_TRUTH_MIN_TAPE 1.0f // a row needs this many pixels worth of tape to have a true line position
+
+typedef struct camera{
+    int width, height;  // image size in pixels
+    float height_m;     // lens above the floor, m
+    float forward_m;    // lens ahead of the axle, m
+    float pitch;        // tilt down from horizontal, radians
+    float hfov;         // horizontal field of view, radians
+    float noise;        // standard deviation of the brightness noise, 0 to 1
+    // ground point of every sample relative to the lens in robot axes (forward, left), m
+    // NAN where the ray doesn't hit the floor
+    float *ground;
+} camera_t;
+
+void camera_init(camera_t *cam, int width, int height, float height_m, float forward_m, float pitch_deg, float hfov_deg);
+void camera_free(camera_t *cam);
+
+// render image rows firstRow .. firstRow+numRows-1 into data (numRows*width*2 bytes)
+void render_frame(const camera_t *cam, const track_t *track, const robot_t *robot,
+                  uint8_t *data, int firstRow, int numRows);
+
+// where the tape really is in each of the image rows, the center of its coverage in pixels from the left
+// (no noise, no thresholding). NAN for rows without enough tape, returns how many rows had it.
+// Assumes the tape crosses each row once, which holds for the rows the line follower scans
+int render_line_truth(const camera_t *cam, const track_t *track, const robot_t *robot,
+                      const int *rows, int nrows, float *centers);
+
+#endif
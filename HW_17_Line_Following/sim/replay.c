@@ -0,0 +1,294 @@
+// replay.c
+// read framelink packets from a recording and give each frame to control_frame(),
+// the same call the firmware makes when getFrame() returns a new frame
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "control.h"
+#include "framelink.h"
+#include "replay.h"
+
+// a recording being read, every frame comes out as RGB565 whatever format it was sent in
+typedef struct recording {
+    FILE *f;
+    framelinkHeader_t h;
+    uint8_t payload[LINE_MAX_WIDTH * 480 * 3]; // room for a worst case delta frame
+    uint8_t rgb[LINE_MAX_WIDTH * 480 * 2] __attribute__((aligned(4))); // the frame, and what the next delta applies to
+    bool have_colour;  // rgb holds a colour frame a delta can apply to
+    uint32_t colour_seq;
+    int colour_pixels;
+    long bad, skipped, broken;
+} recording_t;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// find the next header, skipping any text the robot printed between frames
+static bool next_header(FILE *f, framelinkHeader_t *h, long *skipped) {
+    uint8_t *p = (uint8_t *)h;
+    size_t have = 0;
+    for (;;) {
+        int c = fgetc(f);
+        if (c == EOF) {
+            return false;
+        }
+        p[have++] = (uint8_t)c;
+        if (have == 4) {
+            uint32_t magic;
+            memcpy(&magic, p, 4);
+            if (magic != FRAMELINK_MAGIC) {
+                memmove(p, p + 1, 3);
+                have = 3;
+                (*skipped)++;
+            }
+        } else if (have == sizeof(*h)) {
+            return true;
+        }
+    }
+}
+
+// next frame that decodes, false at the end of the file
+static bool next_frame(recording_t *r) {
+    framelinkHeader_t *h = &r->h;
+    while (next_header(r->f, h, &r->skipped)) {
+        if (h->size > sizeof(r->payload) || fread(r->payload, 1, h->size, r->f) != h->size) {
+            r->bad++;
+            return false;
+        }
+        if (!framelink_check(h, r->payload) || h->width > LINE_MAX_WIDTH
+            || (uint32_t)h->width * h->numRows * 2 > sizeof(r->rgb)) {
+            r->bad++;
+            continue;
+        }
+        int pixels = h->width * h->numRows;
+        if (h->format == FRAMELINK_MONO) {
+            framelink_unpack_mono(r->rgb, r->payload, h->width, h->numRows);
+            r->have_colour = false;
+        } else if (h->format == FRAMELINK_MONO_RLE) {
+            r->have_colour = false;
+            if (!framelink_decode_rle(r->rgb, r->payload, h->size, h->width, h->numRows)) {
+                r->bad++;
+                continue;
+            }
+        } else if (h->format == FRAMELINK_RGB565_DELTA) {
+            // only against the frame it was made from, after a lost packet wait for the next raw frame
+            if (!r->have_colour || h->reference != (uint16_t)r->colour_seq || r->colour_pixels != pixels
+                || !framelink_decode_delta(r->rgb, r->payload, h->size, pixels)) {
+                r->have_colour = false;
+                r->broken++;
+                continue;
+            }
+            r->colour_seq = h->sequence;
+        } else {
+            memcpy(r->rgb, r->payload, h->size);
+            r->have_colour = true;
+            r->colour_seq = h->sequence;
+            r->colour_pixels = pixels;
+        }
+        return true;
+    }
+    return false;
+}
+
+static recording_t *open_recording(const char *path) {
+    recording_t *r = calloc(1, sizeof(recording_t));
+    if (r == NULL) {
+        return NULL;
+    }
+    r->f = fopen(path, "rb");
+    if (r->f == NULL) {
+        free(r);
+        return NULL;
+    }
+    return r;
+}
+
+static int close_recording(recording_t *r) {
+    int bad = (int)r->bad;
+    fprintf(stderr, "%ld bad packets, %ld bytes of text skipped\n", r->bad, r->skipped);
+    if (r->broken > 0) {
+        fprintf(stderr, "%ld delta frames skipped waiting for a raw frame\n", r->broken);
+    }
+    fclose(r->f);
+    free(r);
+    return bad;
+}
+
+int replay_run(const char *path) {
+    recording_t *r = open_recording(path);
+    if (r == NULL) {
+        return -1;
+    }
+    lineControl_t ctl;
+    int width = 0, height = 0;
+    long frames = 0, found = 0, gaps = 0;
+    uint32_t last_seq = 0;
+    double detect_ns = 0;
+    static const char *formats[] = {"rgb565", "mono", "rle", "delta"};
+
+    printf("sequence,timestamp_us,format,found,position,offset,heading,curvature,confidence,rows\n");
+    while (next_frame(r)) {
+        const framelinkHeader_t *h = &r->h;
+        if (h->width != width || h->height != height) {
+            // recordings can change size, the detector rows depend on it
+            width = h->width;
+            height = h->height;
+            control_init(&ctl, width, height, 0.01f);
+        }
+        if (frames > 0 && h->sequence != last_seq + 1) {
+            gaps++;
+        }
+        last_seq = h->sequence;
+        frames++;
+
+        double t0 = now_ns();
+        bool ok = control_frame(&ctl, r->rgb, h->firstRow, h->numRows);
+        detect_ns += now_ns() - t0;
+        found += ok;
+        printf("%u,%llu,%s,%d,%.2f,%.2f,%.4f,%.5f,%.2f,%d\n", h->sequence, (unsigned long long)h->timestamp,
+               formats[h->format], ok, ctl.position, ctl.line.offset,
+               ctl.line.heading, ctl.line.curvature, ctl.line.confidence, ctl.line.rowsFound);
+    }
+    fprintf(stderr, "%ld frames, line found in %ld, %ld sequence gaps\n", frames, found, gaps);
+    fprintf(stderr, "detector: %.0f ns per frame (host)\n", frames ? detect_ns / frames : 0);
+    return close_recording(r);
+}
+
+// ---- row kernel check ----
+
+// the original cam.c code: convertImage() unpacks the whole frame into r, g, b planes
+static void reference_convert(const uint8_t *raw, int pixels, uint8_t *r, uint8_t *g, uint8_t *b) {
+    int i;
+    for (i = 0; i < pixels; i++) {
+        r[i] = (raw[2*i+1] >> 3) << 3;
+        g[i] = (((raw[2*i+1] & 0b111) << 3) | raw[2*i] >> 5) << 2;
+        b[i] = (raw[2*i] & 0b11111) << 3;
+    }
+}
+
+// then findLine() averages the row, overwrites it with 0/255 and takes the center of mass with 765 per white pixel
+static int reference_find_line_planes(uint8_t *r, uint8_t *g, uint8_t *b, int width) {
+    int sumBright = 0;
+    int i;
+    for (i = 0; i < width; i++) {
+        sumBright = sumBright + r[i] + g[i] + b[i];
+    }
+    int avgBright = sumBright / width;
+    for (i = 0; i < width; i++) {
+        int mass = r[i] + g[i] + b[i];
+        uint8_t v = mass < avgBright ? 0 : 255;
+        r[i] = g[i] = b[i] = v;
+    }
+    int sumMass = 0, sumMassR = 0;
+    for (i = 0; i < width; i++) {
+        int mass = r[i] + g[i] + b[i];
+        sumMass = sumMass + mass;
+        sumMassR = sumMassR + mass * i;
+    }
+    return (int)((float)sumMassR / sumMass);
+}
+
+static int reference_find_line(const uint8_t *raw, int width, int row) {
+    uint8_t r[LINE_MAX_WIDTH], g[LINE_MAX_WIDTH], b[LINE_MAX_WIDTH];
+    reference_convert(raw + row * width * 2, width, r, g, b);
+    return reference_find_line_planes(r, g, b, width);
+}
+
+// every row of every frame through the reference and the line.c kernels: the centers have to match
+// exactly, the source bytes must come out untouched, and the time per row for each.
+// Then per frame the way the firmware used to do it (convertImage() of the whole frame and findLine()
+// on the middle row) against findLineRaw() on the same row straight from the camera bytes
+int replay_check_kernel(const char *path) {
+    recording_t *r = open_recording(path);
+    if (r == NULL) {
+        return -1;
+    }
+    static uint8_t copy[LINE_MAX_WIDTH * 480 * 2];
+    static uint8_t pr[LINE_MAX_WIDTH * 480], pg[LINE_MAX_WIDTH * 480], pb[LINE_MAX_WIDTH * 480];
+    long frames = 0, rows = 0, mismatches = 0, mutated = 0, frame_mismatches = 0;
+    double ref_ns = 0, mean_ns = 0, single_ns = 0, convert_frame_ns = 0, raw_frame_ns = 0;
+    volatile int sink = 0;
+    int row, rep;
+    const int reps = 20; // rows are tiny, time a few rounds of each
+
+    while (next_frame(r)) {
+        const framelinkHeader_t *h = &r->h;
+        uint32_t bytes = (uint32_t)h->width * h->numRows * 2;
+        memcpy(copy, r->rgb, bytes);
+        for (row = 0; row < h->numRows; row++) {
+            int want = reference_find_line(r->rgb, h->width, row);
+            int contrast, count;
+            int got = findLineRawStats(r->rgb, h->width, row, &contrast, &count);
+            int raw = findLineRaw(r->rgb, h->width, row);
+            // the single pass kernel given the threshold the row would have had
+            int sum = 0, i;
+            const uint8_t *p = r->rgb + row * h->width * 2;
+            for (i = 0; i < h->width; i++) sum += pixelBrightness(p[2*i], p[2*i+1]);
+            int single = findLineThreshold(r->rgb, h->width, row, sum / h->width, NULL, NULL);
+            if (got != want || raw != want || single != want) {
+                if (mismatches < 10) {
+                    fprintf(stderr, "frame %u row %d: reference %d, kernel %d/%d, single pass %d\n",
+                            h->sequence, h->firstRow + row, want, got, raw, single);
+                }
+                mismatches++;
+            }
+            rows++;
+
+            double t0 = now_ns();
+            for (rep = 0; rep < reps; rep++) sink += reference_find_line(r->rgb, h->width, row);
+            double t1 = now_ns();
+            for (rep = 0; rep < reps; rep++) sink += findLineRaw(r->rgb, h->width, row);
+            double t2 = now_ns();
+            for (rep = 0; rep < reps; rep++) sink += findLineThreshold(r->rgb, h->width, row, 300, NULL, NULL);
+            double t3 = now_ns();
+            ref_ns += t1 - t0;
+            mean_ns += t2 - t1;
+            single_ns += t3 - t2;
+        }
+        if (memcmp(copy, r->rgb, bytes) != 0) {
+            mutated++;
+        }
+
+        int mid = h->numRows / 2;
+        int fused = 0, converted = 0;
+        double t0 = now_ns();
+        for (rep = 0; rep < reps; rep++) {
+            reference_convert(r->rgb, h->width * h->numRows, pr, pg, pb);
+            converted = reference_find_line_planes(pr + mid * h->width, pg + mid * h->width, pb + mid * h->width, h->width);
+            sink += converted;
+        }
+        double t1 = now_ns();
+        for (rep = 0; rep < reps; rep++) {
+            fused = findLineRaw(r->rgb, h->width, mid);
+            sink += fused;
+        }
+        double t2 = now_ns();
+        convert_frame_ns += t1 - t0;
+        raw_frame_ns += t2 - t1;
+        if (fused != converted) {
+            frame_mismatches++;
+        }
+        frames++;
+    }
+    (void) sink;
+    printf("%ld frames, %ld rows: %ld centers differ from the reference, %ld frames modified\n",
+           frames, rows, mismatches + frame_mismatches, mutated);
+    if (rows > 0) {
+#ifdef LINE_SIM_NO_VECTORIZE
+        printf("timed without auto-vectorisation, like the M33\n");
+#else
+        printf("timed with the compiler's defaults, host SIMD can favour the reference loops\n");
+#endif
+        printf("per row (host): reference %.0f ns, row average kernel %.0f ns, single pass %.0f ns\n",
+               ref_ns / rows / reps, mean_ns / rows / reps, single_ns / rows / reps);
+        printf("per frame (host): convertImage + findLine %.0f ns, findLineRaw %.0f ns (%.1fx)\n",
+               convert_frame_ns / frames / reps, raw_frame_ns / frames / reps,
+               raw_frame_ns > 0 ? convert_frame_ns / raw_frame_ns : 0);
+    }
+    int bad = close_recording(r);
+    return (mismatches > 0 || frame_mismatches > 0 || mutated > 0) ? 1 : bad;
+}
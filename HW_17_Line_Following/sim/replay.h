@@ -0,0 +1,14 @@
+// replay.h
+// Runs a framelink recording (python/framelink.py record) back through the line detector.
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// one CSV line per frame on stdout, then a summary, returns the number of bad packets or -1 if the file can't be read
+int replay_run(const char *path);
+
+// golden check and benchmark of the line.c row kernel against the original three pass findLine(),
+// over every row of every frame, and the time per frame of convertImage() + findLine() against
+// findLineRaw(). Returns 0 if all the centers match
+int replay_check_kernel(const char *path);
+
+#endif
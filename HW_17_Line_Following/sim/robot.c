@@ -0,0 +1,26 @@
+// robot.c
+// differential drive, see robot.h
+#include <math.h>
+#include "robot.h"
+
+void robot_init(robot_t *r, float x, float y, float heading) {
+    r->x = x;
+    r->y = y;
+    r->heading = heading;
+    r->left = 0;
+    r->right = 0;
+}
+
+void robot_step(robot_t *r, float left_duty, float right_duty, float dt) {
+    // exact first order response over the step, stays stable for any dt
+    float k = 1.0f - expf(-dt / ROBOT_MOTOR_TAU);
+    r->left += (left_duty * ROBOT_V_MAX - r->left) * k;
+    r->right += (right_duty * ROBOT_V_MAX - r->right) * k;
+
+    float v = (r->left + r->right) / 2;
+    float w = (r->right - r->left) / ROBOT_TRACK_WIDTH;
+    float mid = r->heading + w * dt / 2; // move along the mid step heading, good enough at 1 ms
+    r->x += v * cosf(mid) * dt;
+    r->y += v * sinf(mid) * dt;
+    r->heading += w * dt;
+}
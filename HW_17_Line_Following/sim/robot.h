@@ -0,0 +1,20 @@
+// robot.h
+// Kinematic model of the two wheeled robot: each wheel speed follows its PWM duty through
+// a first order lag, the body moves like a differential drive without slip.
+#ifndef ROBOT_H
+#define ROBOT_H
+
+#define ROBOT_V_MAX 1.0f        // wheel speed at 100% duty, m/s
+#define ROBOT_MOTOR_TAU 0.05f   // motor + wheel time constant, s
+#define ROBOT_TRACK_WIDTH 0.12f // distance between the wheels, m
+
+typedef struct robot{
+    float x, y;        // middle of the axle, m
+    float heading;     // radians, 0 is +x and anticlockwise is positive
+    float left, right; // wheel speeds, m/s
+} robot_t;
+
+void robot_init(robot_t *r, float x, float y, float heading);
+void robot_step(robot_t *r, float left_duty, float right_duty, float dt);
+
+#endif
@@ -0,0 +1,400 @@
+// sim.c
+// Host simulator for the line follower: the control code from control.c drives a model robot
+// around a track, fed by frames rendered from where the camera would be. Runs many times
+// faster than real time, so gains and speeds can be tried over many laps before flashing.
+//
+//   line_sim [--laps n] [--kp gain] [--track oval|wiggle|file.pgm] [--res m_per_px]
+//            [--start x,y,deg] [--noise sd] [--seed n] [--in1-left] [--max-time s]
+//            [--save-track file.pgm] [--frame-pgm file.pgm] [--record file.flk]
+//            [--record-format rgb565|mono|rle|delta] [--threshold mean|otsu|hysteresis]
+//   line_sim --replay file.flk
+//   line_sim --check-kernel file.flk
+//
+// --record writes every frame the controller saw as framelink packets (see framelink.h), in the
+// format the robot would stream it, and reports the compression ratio and encode time.
+// --replay runs a recording from the robot or the sim through the detector and prints CSV.
+// --check-kernel compares the row kernel in line.c with the original findLine() on a recording, and times
+// the old convertImage() + findLine() frame against findLineRaw() on the same row. line_sim is built
+// without auto-vectorisation so those timings rank the loops the way the M33 would (see CMakeLists.txt).
+// --threshold picks how estimateLine thresholds rows, see lineThreshold_t in line.h.
+//
+// Every run also scores the detector: each frame's fit is compared with where the tape really is in
+// the scanned rows (render_line_truth), and estimateLine is timed on its own.
+//
+// Wheels: control_step() gives IN1 base + turn, as the robot that raced did
+// (HW_18_TechCup/LINE_FOLLOWING_CODE). With the camera as it is set up (MVFP 0x07, not
+// mirrored) that only steers towards the line when IN1 drives the right wheel, so that is the
+// default here, whatever the comments in motor.h call it. --in1-left wires it the other way.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "control.h"
+#include "motor.h"
+#include "hardware/pwm.h"
+#include "track.h"
+#include "robot.h"
+#include "render.h"
+#include "framelink.h"
+#include "replay.h"
+
+#define IMAGE_W 80  // IMAGESIZEX in cam.h, OV7670_SIZE_DIV8
+#define IMAGE_H 60
+#define PHYSICS_DT 0.001f
+#define CONTROL_PERIOD 0.01f // CONTROL_PERIOD_US in HW_17_Line_Following.c
+#define FRAME_PERIOD (1.0f / 30)
+#define LOST_ABORT_S 1.5f    // give up on the run after this long without the line
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: line_sim [--laps n] [--kp gain] [--track oval|wiggle|file.pgm] [--res m_per_px]\n"
+                    "                [--start x,y,deg] [--noise sd] [--seed n] [--in1-left] [--max-time s]\n"
+                    "                [--save-track file.pgm] [--frame-pgm file.pgm] [--record file.flk]\n"
+                    "                [--record-format rgb565|mono|rle|delta] [--threshold mean|otsu|hysteresis]\n"
+                    "       line_sim --replay file.flk\n"
+                    "       line_sim --check-kernel file.flk\n");
+    exit(2);
+}
+
+// the whole camera image as an 8 bit PGM, to check what the robot sees
+static bool write_frame_pgm(const char *path, const uint8_t *data, int width, int height) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    fprintf(f, "P5\n%d %d\n255\n", width, height);
+    int i;
+    for (i = 0; i < width * height; i++) {
+        uint8_t g6 = (uint8_t)(((data[2*i+1] & 0x07) << 3) | (data[2*i] >> 5));
+        fputc(g6 * 255 / 63, f);
+    }
+    return fclose(f) == 0;
+}
+
+static long record_frames = 0;
+static long record_raw = 0, record_sent = 0; // payload bytes, uncompressed and as written
+static double record_encode_s = 0;
+
+// the same encoding the robot does in link_send(), without the periodic raw colour frames
+static void record_frame(FILE *f, uint8_t format, const uint8_t *data, int firstRow, int numRows,
+                         uint32_t sequence, uint64_t timestamp) {
+    static uint8_t payload[IMAGE_W * IMAGE_H * 3];
+    static uint8_t prev[IMAGE_W * IMAGE_H * 2];
+    int pixels = IMAGE_W * numRows;
+    uint32_t raw = framelink_size(FRAMELINK_RGB565, IMAGE_W, numRows);
+    uint32_t size;
+    uint16_t reference = 0;
+    double e0 = now_s();
+    if (format == FRAMELINK_MONO) {
+        size = framelink_pack_mono(payload, data, IMAGE_W, numRows);
+    } else if (format == FRAMELINK_MONO_RLE) {
+        size = framelink_encode_rle(payload, data, IMAGE_W, numRows);
+    } else {
+        size = 0;
+        if (format == FRAMELINK_RGB565_DELTA && record_frames > 0) {
+            size = framelink_encode_delta(payload, raw, data, prev, pixels);
+            reference = (uint16_t)(sequence - 1);
+        }
+        if (size == 0) {
+            format = FRAMELINK_RGB565;
+            memcpy(payload, data, raw);
+            size = raw;
+        }
+        memcpy(prev, data, raw);
+    }
+    record_encode_s += now_s() - e0;
+    bool mono = (format == FRAMELINK_MONO || format == FRAMELINK_MONO_RLE);
+    record_raw += mono ? framelink_size(FRAMELINK_MONO, IMAGE_W, numRows) : raw;
+    record_sent += size;
+    record_frames++;
+
+    framelinkHeader_t h;
+    framelink_header(&h, format, IMAGE_W, IMAGE_H, firstRow, numRows, reference, sequence, timestamp, payload, size);
+    fwrite(&h, sizeof(h), 1, f);
+    fwrite(payload, 1, size, f);
+}
+
+int main(int argc, char **argv) {
+    int laps = 5;
+    float kp = 0.02f;
+    const char *track_name = "oval";
+    float res = 0.005f;
+    bool have_start = false;
+    float start_x = 0, start_y = 0, start_deg = 0;
+    float noise = 0.02f;
+    unsigned seed = 1;
+    bool in1_left = false;
+    float max_time = 0;
+    const char *save_track = NULL;
+    const char *frame_pgm = NULL;
+    const char *record = NULL;
+    uint8_t record_format = FRAMELINK_RGB565;
+    lineThreshold_t threshold = LINE_THRESHOLD_MEAN;
+
+    int i;
+    for (i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(a, "--in1-left") == 0) {
+            in1_left = true;
+            continue;
+        }
+        if (v == NULL) usage();
+        i++;
+        if (strcmp(a, "--laps") == 0) laps = atoi(v);
+        else if (strcmp(a, "--kp") == 0) kp = strtof(v, NULL);
+        else if (strcmp(a, "--track") == 0) track_name = v;
+        else if (strcmp(a, "--res") == 0) res = strtof(v, NULL);
+        else if (strcmp(a, "--noise") == 0) noise = strtof(v, NULL);
+        else if (strcmp(a, "--seed") == 0) seed = (unsigned)atoi(v);
+        else if (strcmp(a, "--max-time") == 0) max_time = strtof(v, NULL);
+        else if (strcmp(a, "--save-track") == 0) save_track = v;
+        else if (strcmp(a, "--frame-pgm") == 0) frame_pgm = v;
+        else if (strcmp(a, "--record") == 0) record = v;
+        else if (strcmp(a, "--record-format") == 0) {
+            if (strcmp(v, "rgb565") == 0) record_format = FRAMELINK_RGB565;
+            else if (strcmp(v, "mono") == 0) record_format = FRAMELINK_MONO;
+            else if (strcmp(v, "rle") == 0) record_format = FRAMELINK_MONO_RLE;
+            else if (strcmp(v, "delta") == 0) record_format = FRAMELINK_RGB565_DELTA;
+            else usage();
+        }
+        else if (strcmp(a, "--threshold") == 0) {
+            if (strcmp(v, "mean") == 0) threshold = LINE_THRESHOLD_MEAN;
+            else if (strcmp(v, "otsu") == 0) threshold = LINE_THRESHOLD_OTSU;
+            else if (strcmp(v, "hysteresis") == 0) threshold = LINE_THRESHOLD_HYSTERESIS;
+            else usage();
+        }
+        else if (strcmp(a, "--check-kernel") == 0) {
+            int bad = replay_check_kernel(v);
+            if (bad < 0) fprintf(stderr, "can't read %s\n", v);
+            return bad == 0 ? 0 : 1;
+        }
+        else if (strcmp(a, "--replay") == 0) {
+            int bad = replay_run(v);
+            if (bad < 0) fprintf(stderr, "can't read %s\n", v);
+            return bad == 0 ? 0 : 1;
+        }
+        else if (strcmp(a, "--start") == 0) {
+            if (sscanf(v, "%f,%f,%f", &start_x, &start_y, &start_deg) != 3) usage();
+            have_start = true;
+        }
+        else usage();
+    }
+    if (laps < 1 || res <= 0) usage();
+    srand(seed);
+
+    // 2 m straights, 0.5 m radius turns and 19 mm electrical tape
+    track_t track;
+    bool ok;
+    if (strcmp(track_name, "oval") == 0) {
+        ok = track_oval(&track, 2.0f, 0.5f, 0, 0.019f, res);
+    } else if (strcmp(track_name, "wiggle") == 0) {
+        ok = track_oval(&track, 2.0f, 0.5f, 0.1f, 0.019f, res);
+    } else {
+        ok = track_load_pgm(&track, track_name, res);
+        if (ok && !have_start) {
+            fprintf(stderr, "%s: a track image needs --start x,y,deg\n", track_name);
+            return 2;
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "can't make track %s\n", track_name);
+        return 1;
+    }
+    if (have_start) {
+        track.start_x = start_x;
+        track.start_y = start_y;
+        track.start_heading = start_deg * (float)M_PI / 180;
+    }
+    if (save_track != NULL && !track_save_pgm(&track, save_track)) {
+        fprintf(stderr, "can't write %s\n", save_track);
+    }
+
+    // camera on a mast at the front, tilted down so the line rows see 6 to 27 cm ahead
+    camera_t cam;
+    camera_init(&cam, IMAGE_W, IMAGE_H, 0.12f, 0.05f, 40, 60);
+    cam.noise = noise;
+
+    robot_t robot;
+    robot_init(&robot, track.start_x, track.start_y, track.start_heading);
+
+    lineControl_t ctl;
+    control_init(&ctl, IMAGE_W, IMAGE_H, CONTROL_PERIOD);
+    setLineThreshold(threshold);
+    pwm_motor_init(IN1_PIN);
+    pwm_motor_init(IN2_PIN);
+
+    if (frame_pgm != NULL) {
+        static uint8_t full[IMAGE_W * IMAGE_H * 2];
+        render_frame(&cam, &track, &robot, full, 0, IMAGE_H);
+        if (!write_frame_pgm(frame_pgm, full, IMAGE_W, IMAGE_H)) {
+            fprintf(stderr, "can't write %s\n", frame_pgm);
+        }
+    }
+
+    // the same band of rows the firmware captures, one frame behind like the camera DMA
+    int firstRow = LINE_FAR_ROW;
+    int numRows = ctl.nearRow - LINE_FAR_ROW + 1;
+    static uint8_t frames[2][IMAGE_W * IMAGE_H * 2] __attribute__((aligned(4))); // word aligned like the camera buffers
+    float truth[2][LINE_MAX_ROWS]; // true line center in each scanned row when the frame was rendered
+    int truth_rows[2] = {0, 0};
+    int line_rows[LINE_MAX_ROWS];
+    int num_line_rows = getLineRows(line_rows);
+    int exposing = 0;
+    bool ready = false;
+    FILE *record_file = NULL;
+    if (record != NULL && (record_file = fopen(record, "wb")) == NULL) {
+        fprintf(stderr, "can't write %s\n", record);
+    }
+
+    // laps are whole turns around the middle of the track
+    float last_angle = atan2f(robot.y - track.center_y, robot.x - track.center_x);
+    float turned = 0;
+    float lap_start = 0;
+    int laps_done = 0;
+
+    long steps = 0, control_steps = 0, frame_count = 0;
+    int next_frame = 0, next_control = 0; // in physics steps
+    int frame_steps = (int)lroundf(FRAME_PERIOD / PHYSICS_DT);
+    int control_every = (int)lroundf(CONTROL_PERIOD / PHYSICS_DT);
+    long lost_events = 0, lost_frames = 0;
+    bool was_found = true;
+    float lost_since = -1;
+    double control_ns = 0, control_max_ns = 0;
+    double render_s = 0;
+    long detect_frames = 0, truth_frames = 0, truth_found = 0, false_found = 0, fit_rows = 0;
+    double fit_err = 0, fit_err_max = 0, detect_ns = 0;
+    float fastest = 0, slowest = 0, lap_sum = 0;
+    const char *result = "done";
+
+    if (max_time <= 0) max_time = laps * 60.0f;
+    double wall_start = now_s();
+
+    for (;;) {
+        float t = steps * PHYSICS_DT;
+        if (t >= max_time) {
+            result = "out of time";
+            break;
+        }
+
+        if (steps == next_frame) {
+            // the frame that was exposing is now in memory, start the next one from here
+            double r0 = now_s();
+            render_frame(&cam, &track, &robot, frames[exposing], firstRow, numRows);
+            render_s += now_s() - r0;
+            truth_rows[exposing] = render_line_truth(&cam, &track, &robot, line_rows, num_line_rows, truth[exposing]);
+            exposing ^= 1;
+            ready = frame_count > 0;
+            frame_count++;
+            next_frame += frame_steps;
+        }
+
+        if (steps == next_control) {
+            // the frame the controller is about to get, as the robot would send it over USB
+            if (ready && record_file != NULL) {
+                record_frame(record_file, record_format, frames[exposing], firstRow, numRows,
+                             (uint32_t)(frame_count - 2), (uint64_t)(t * 1e6f));
+            }
+            double c0 = now_s();
+            if (ready) {
+                ready = false;
+                double d0 = now_s();
+                bool found = control_frame(&ctl, frames[exposing], firstRow, numRows);
+                detect_ns += (now_s() - d0) * 1e9;
+                detect_frames++;
+                // the fit against the real tape, in every scanned row that has some
+                if (truth_rows[exposing] > 0) {
+                    truth_frames++;
+                    truth_found += found;
+                } else if (found) {
+                    false_found++;
+                }
+                if (found) {
+                    int k;
+                    for (k = 0; k < num_line_rows; k++) {
+                        if (isnan(truth[exposing][k])) continue;
+                        float fit = IMAGE_W / 2.0f + linePosition(&ctl.line, (float)(ctl.nearRow - line_rows[k]));
+                        double err = fabs(fit - truth[exposing][k]);
+                        fit_err += err;
+                        if (err > fit_err_max) fit_err_max = err;
+                        fit_rows++;
+                    }
+                }
+                if (!found) {
+                    lost_frames++;
+                    if (was_found) lost_events++;
+                    if (lost_since < 0) lost_since = t;
+                } else {
+                    lost_since = -1;
+                }
+                was_found = found;
+            }
+            control_step(&ctl, kp);
+            double ns = (now_s() - c0) * 1e9;
+            control_ns += ns;
+            if (ns > control_max_ns) control_max_ns = ns;
+            control_steps++;
+            next_control += control_every;
+            if (lost_since >= 0 && t - lost_since > LOST_ABORT_S) {
+                result = "lost the line";
+                break;
+            }
+        }
+
+        float in1 = sim_pwm_duty(IN1_PIN), in2 = sim_pwm_duty(IN2_PIN);
+        if (in1_left) {
+            robot_step(&robot, in1, in2, PHYSICS_DT);
+        } else {
+            robot_step(&robot, in2, in1, PHYSICS_DT);
+        }
+        steps++;
+
+        float angle = atan2f(robot.y - track.center_y, robot.x - track.center_x);
+        float d = angle - last_angle;
+        if (d > (float)M_PI) d -= 2 * (float)M_PI;
+        if (d < -(float)M_PI) d += 2 * (float)M_PI;
+        turned += d;
+        last_angle = angle;
+        if (fabsf(turned) >= 2 * (float)M_PI * (laps_done + 1)) {
+            float lap = t + PHYSICS_DT - lap_start;
+            lap_start += lap;
+            laps_done++;
+            if (laps_done == 1 || lap < fastest) fastest = lap;
+            if (laps_done == 1 || lap > slowest) slowest = lap;
+            lap_sum += lap;
+            printf("lap %d: %.2f s\n", laps_done, lap);
+            if (laps_done == laps) break;
+        }
+    }
+    double wall = now_s() - wall_start;
+    float sim_time = steps * PHYSICS_DT;
+
+    printf("%s after %.1f s simulated, %d/%d laps\n", result, sim_time, laps_done, laps);
+    if (laps_done > 0) {
+        printf("lap time: mean %.2f s, best %.2f s, worst %.2f s\n", lap_sum / laps_done, fastest, slowest);
+    }
+    printf("line lost %ld times, %ld of %ld frames without the line\n", lost_events, lost_frames, frame_count);
+    printf("detector: found in %ld of %ld frames with tape in view (%.1f%%), %ld without tape\n",
+           truth_found, truth_frames, truth_frames ? 100.0 * truth_found / truth_frames : 0, false_found);
+    printf("detector: fit %.2f px mean, %.2f px max from the tape over %ld rows, %.0f ns per frame (host)\n",
+           fit_rows ? fit_err / fit_rows : 0, fit_err_max, fit_rows, detect_frames ? detect_ns / detect_frames : 0);
+    printf("control: %ld steps, %.0f ns mean, %.0f ns max (host)\n",
+           control_steps, control_steps ? control_ns / control_steps : 0, control_max_ns);
+    printf("render: %.1f us per frame, %.0fx real time\n",
+           frame_count ? render_s / frame_count * 1e6 : 0, wall > 0 ? sim_time / wall : 0);
+
+    if (record_file != NULL) {
+        fclose(record_file);
+        printf("record: %ld frames, %.2f compression, %.2f us to encode (host)\n", record_frames,
+               record_sent ? (double)record_raw / record_sent : 0, record_frames ? record_encode_s / record_frames * 1e6 : 0);
+    }
+    camera_free(&cam);
+    track_free(&track);
+    return laps_done == laps ? 0 : 1;
+}
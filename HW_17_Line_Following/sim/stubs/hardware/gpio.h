@@ -0,0 +1,22 @@
+// host stand-in for hardware/gpio.h
+#ifndef SIM_HARDWARE_GPIO_H
+#define SIM_HARDWARE_GPIO_H
+
+#include "pico/stdlib.h"
+
+#define GPIO_IN 0
+#define GPIO_OUT 1
+
+typedef enum {
+    GPIO_FUNC_I2C = 3,
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+} gpio_function_t;
+
+void gpio_set_function(uint gpio, gpio_function_t fn);
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+void gpio_pull_up(uint gpio);
+
+#endif
@@ -0,0 +1,17 @@
+// host stand-in for hardware/i2c.h, the transfers go to the register model in cam_stub.c
+#ifndef SIM_HARDWARE_I2C_H
+#define SIM_HARDWARE_I2C_H
+
+#include <stddef.h>
+#include "pico/stdlib.h"
+
+typedef struct i2c_inst { int index; } i2c_inst_t;
+extern i2c_inst_t sim_i2c0, sim_i2c1;
+#define i2c0 (&sim_i2c0)
+#define i2c1 (&sim_i2c1)
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+#endif
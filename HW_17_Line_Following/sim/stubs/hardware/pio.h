@@ -0,0 +1,52 @@
+// host stand-in for hardware/pio.h. There is no instruction set here: cam_stub.c steps a model of
+// the cam.pio program, these calls set up its fifos and shift config the way the SDK would
+#ifndef SIM_HARDWARE_PIO_H
+#define SIM_HARDWARE_PIO_H
+
+#include "pico/stdlib.h"
+
+#define SIM_PIO_FIFO_DEPTH 4
+
+typedef struct pio_hw {
+    volatile uint32_t rxf[4]; // only the address matters, the DMA model reads the RX fifo itself
+} pio_hw_t;
+typedef pio_hw_t *PIO;
+extern pio_hw_t sim_pio0;
+#define pio0 (&sim_pio0)
+
+typedef struct pio_program {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+enum pio_fifo_join { PIO_FIFO_JOIN_NONE = 0, PIO_FIFO_JOIN_TX = 1, PIO_FIFO_JOIN_RX = 2 };
+
+typedef struct {
+    uint in_base;
+    bool in_shift_right;
+    bool autopush;
+    uint push_threshold;
+    enum pio_fifo_join join;
+    float clkdiv;
+} pio_sm_config;
+
+pio_sm_config pio_get_default_sm_config(void);
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base);
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join);
+void sm_config_set_clkdiv(pio_sm_config *c, float div);
+
+uint pio_add_program(PIO pio, const pio_program_t *program);
+int pio_claim_unused_sm(PIO pio, bool required);
+int pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+int pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+uint pio_encode_jmp(uint addr);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+
+#endif
@@ -0,0 +1,16 @@
+// host stand-in for hardware/pwm.h, the levels end up in sim_pwm_duty() for the robot model
+#ifndef SIM_HARDWARE_PWM_H
+#define SIM_HARDWARE_PWM_H
+
+#include "pico/stdlib.h"
+
+uint pwm_gpio_to_slice_num(uint gpio);
+void pwm_set_clkdiv(uint slice_num, float divider);
+void pwm_set_wrap(uint slice_num, uint16_t wrap);
+void pwm_set_enabled(uint slice_num, bool enabled);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+
+// not in the SDK: duty cycle (0 to 1) last set on a pin, 0 while its slice is disabled
+float sim_pwm_duty(uint gpio);
+
+#endif
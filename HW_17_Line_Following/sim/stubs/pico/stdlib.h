@@ -0,0 +1,19 @@
+// host stand-in for the pico SDK, only what motor.c and cam.c need
+#ifndef SIM_PICO_STDLIB_H
+#define SIM_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+
+// time only moves when the sim says so: sleep_ms() and tight_loop_contents() advance it (cam_stub.c)
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+void sleep_ms(uint32_t ms);
+void tight_loop_contents(void);
+
+#endif
@@ -0,0 +1,175 @@
+// track.c
+// building, loading and sampling the floor image
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "track.h"
+
+#define TRACK_MARGIN 0.3f // floor around the tape, metres
+
+static bool track_alloc(track_t *t, int width, int height, float res) {
+    t->width = width;
+    t->height = height;
+    t->res = res;
+    t->pixels = calloc((size_t)width * height, 1);
+    return t->pixels != NULL;
+}
+
+// middle of all the tape pixels, the lap counter measures turns around it
+static void track_find_center(track_t *t) {
+    double sx = 0, sy = 0, n = 0;
+    int x, y;
+    for (y = 0; y < t->height; y++) {
+        for (x = 0; x < t->width; x++) {
+            if (t->pixels[y*t->width + x] > 127) {
+                sx += x;
+                sy += y;
+                n++;
+            }
+        }
+    }
+    if (n == 0) {
+        n = 1;
+        sx = t->width / 2.0;
+        sy = t->height / 2.0;
+    }
+    t->center_x = (float)((sx / n + 0.5) * t->res);
+    t->center_y = (float)((sy / n + 0.5) * t->res);
+}
+
+// stadium shaped loop: two straights joined by half circles, the straights can wiggle sideways
+// (wiggle is the amplitude in metres of one full sine period along each straight). Driven anticlockwise
+bool track_oval(track_t *t, float straight, float radius, float wiggle, float tape, float res) {
+    float w = straight + 2*radius + 2*TRACK_MARGIN + 2*fabsf(wiggle);
+    float h = 2*radius + 2*TRACK_MARGIN + 2*fabsf(wiggle);
+    if (!track_alloc(t, (int)(w / res), (int)(h / res), res)) {
+        return false;
+    }
+    float cx = w / 2, cy = h / 2;
+
+    // walk the centerline in small steps and paint a disc of tape at every step
+    float perimeter = 2*straight + 2*(float)M_PI*radius;
+    int steps = (int)(perimeter / (res / 4));
+    int r = (int)ceilf(tape / 2 / res) + 1;
+    int i;
+    for (i = 0; i < steps; i++) {
+        float s = perimeter * i / steps;
+        float px, py;
+        if (s < straight) {
+            // bottom straight, left to right
+            px = cx - straight/2 + s;
+            py = cy - radius + wiggle * sinf(2*(float)M_PI * s / straight);
+        } else if (s < straight + (float)M_PI*radius) {
+            float a = (s - straight) / radius - (float)M_PI/2;
+            px = cx + straight/2 + radius*cosf(a);
+            py = cy + radius*sinf(a);
+        } else if (s < 2*straight + (float)M_PI*radius) {
+            // top straight, right to left
+            float u = s - straight - (float)M_PI*radius;
+            px = cx + straight/2 - u;
+            py = cy + radius - wiggle * sinf(2*(float)M_PI * u / straight);
+        } else {
+            float a = (s - 2*straight - (float)M_PI*radius) / radius + (float)M_PI/2;
+            px = cx - straight/2 + radius*cosf(a);
+            py = cy + radius*sinf(a);
+        }
+        int ix = (int)(px / res), iy = (int)(py / res);
+        int dx, dy;
+        for (dy = -r; dy <= r; dy++) {
+            for (dx = -r; dx <= r; dx++) {
+                int x = ix + dx, y = iy + dy;
+                if (x < 0 || y < 0 || x >= t->width || y >= t->height) continue;
+                float ex = (x + 0.5f)*res - px, ey = (y + 0.5f)*res - py;
+                if (ex*ex + ey*ey <= tape*tape/4) {
+                    t->pixels[y*t->width + x] = 255;
+                }
+            }
+        }
+    }
+    t->start_x = cx - straight/2;
+    t->start_y = cy - radius;
+    t->start_heading = atan2f(wiggle * 2*(float)M_PI / straight, 1); // along the bottom straight
+    track_find_center(t);
+    return true;
+}
+
+static int pgm_int(FILE *f) {
+    int c = fgetc(f);
+    while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) c = fgetc(f);
+        }
+        c = fgetc(f);
+    }
+    int v = 0;
+    while (c >= '0' && c <= '9') {
+        v = v*10 + (c - '0');
+        c = fgetc(f);
+    }
+    return v;
+}
+
+// P5 (binary) or P2 (text) grayscale, the top row of the file is the far (+y) edge of the floor.
+// The start pose has to be set by the caller, a picture doesn't say where the start line is
+bool track_load_pgm(track_t *t, const char *path, float res) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    char magic[3] = {0};
+    if (fread(magic, 1, 2, f) != 2 || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '2')) {
+        fclose(f);
+        return false;
+    }
+    int width = pgm_int(f), height = pgm_int(f), maxval = pgm_int(f);
+    if (width <= 0 || height <= 0 || maxval <= 0 || maxval > 255 || !track_alloc(t, width, height, res)) {
+        fclose(f);
+        return false;
+    }
+    int x, y;
+    for (y = height - 1; y >= 0; y--) {
+        for (x = 0; x < width; x++) {
+            int v = magic[1] == '5' ? fgetc(f) : pgm_int(f);
+            if (v == EOF) v = 0;
+            t->pixels[y*width + x] = (uint8_t)(v * 255 / maxval);
+        }
+    }
+    fclose(f);
+    t->start_x = t->start_y = t->start_heading = 0;
+    track_find_center(t);
+    return true;
+}
+
+bool track_save_pgm(const track_t *t, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    fprintf(f, "P5\n# %g m per pixel\n%d %d\n255\n", t->res, t->width, t->height);
+    int y;
+    for (y = t->height - 1; y >= 0; y--) {
+        fwrite(&t->pixels[y*t->width], 1, t->width, f);
+    }
+    return fclose(f) == 0;
+}
+
+void track_free(track_t *t) {
+    free(t->pixels);
+    t->pixels = NULL;
+}
+
+float track_sample(const track_t *t, float x, float y) {
+    float fx = x / t->res - 0.5f, fy = y / t->res - 0.5f;
+    int x0 = (int)floorf(fx), y0 = (int)floorf(fy);
+    float ax = fx - x0, ay = fy - y0;
+    float v[4];
+    int i;
+    for (i = 0; i < 4; i++) {
+        int px = x0 + (i & 1), py = y0 + (i >> 1);
+        v[i] = (px < 0 || py < 0 || px >= t->width || py >= t->height) ? 0 : t->pixels[py*t->width + px];
+    }
+    float top = v[0] + (v[1] - v[0])*ax;
+    float bottom = v[2] + (v[3] - v[2])*ax;
+    return (top + (bottom - top)*ay) / 255.0f;
+}
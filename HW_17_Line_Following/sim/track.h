@@ -0,0 +1,26 @@
+// track.h
+// The floor the simulated robot drives on: a grayscale image (bright = tape) in metres,
+// either built from a procedural centerline or loaded from a PGM file.
+#ifndef TRACK_H
+#define TRACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct track{
+    int width, height;     // image size in pixels
+    float res;             // metres per pixel
+    uint8_t *pixels;       // row 0 is y = 0, x grows to the right and y grows up
+    float start_x, start_y, start_heading; // robot pose at the start line, heading in radians
+    float center_x, center_y; // middle of the tape, laps are counted as turns around this point
+} track_t;
+
+bool track_oval(track_t *t, float straight, float radius, float wiggle, float tape, float res);
+bool track_load_pgm(track_t *t, const char *path, float res);
+bool track_save_pgm(const track_t *t, const char *path);
+void track_free(track_t *t);
+
+// 0 (floor) to 1 (tape) at a point in metres, bilinear between pixels
+float track_sample(const track_t *t, float x, float y);
+
+#endif
@@ -0,0 +1,27 @@
+// telemetry.c
+// seqlock between the control loop (writer) and the display loop (reader)
+#include <string.h>
+#include "hardware/sync.h"
+#include "telemetry.h"
+
+static volatile uint32_t snapshotSeq = 0; // odd while the writer is copying
+static telemetry_t snapshot;
+
+void telemetry_publish(const telemetry_t *t) {
+    snapshotSeq++;
+    __dmb(); // the odd count has to be visible before any of the data changes
+    memcpy((void *)&snapshot, t, sizeof(snapshot));
+    __dmb();
+    snapshotSeq++;
+}
+
+void telemetry_read(telemetry_t *t) {
+    uint32_t before, after;
+    do {
+        before = snapshotSeq;
+        __dmb();
+        memcpy(t, (const void *)&snapshot, sizeof(snapshot));
+        __dmb();
+        after = snapshotSeq;
+    } while ((before & 1) || before != after); // writer was busy, try again
+}
@@ -0,0 +1,32 @@
+// telemetry.h
+// Hands the control loop state from core 0 to core 1 for the OLED and USB logging.
+// Core 0 never waits on core 1: publishing is a seqlock, the reader retries if it
+// caught the writer half way through a copy.
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "camctl.h"
+
+typedef struct telemetry{
+    uint32_t loops;       // control loop iterations, changes every publish
+    uint32_t frame;       // camera sequence number the loop used
+    uint32_t dropped;     // frames the camera overwrote before we got to them
+    uint16_t adc;         // gain pot reading
+    int com;              // line position the controller steered at
+    float gain;
+    float left_speed;
+    float right_speed;
+    uint32_t latency_us;  // capture to actuation
+    uint32_t period_us;   // time between the starts of the last two control iterations
+    uint32_t wait_us;     // time idle waiting for the scheduler tick this iteration
+    uint32_t work_us;     // frame in hand to motors set, the part that has to stay short
+    uint32_t work_max_us; // worst work_us so far
+    camStats_t cam;       // brightness of the last frame, for the exposure loop on core 1
+} telemetry_t;
+
+void telemetry_publish(const telemetry_t *t); // core 0
+void telemetry_read(telemetry_t *t);          // core 1, always returns a consistent copy
+
+#endif
@@ -0,0 +1,170 @@
+// MPU6050 register map and scaling, the bus is in mpu6050_port.h
+
+#include "mpu6050.h"
+#include "mpu6050_port.h"
+
+static int mpu6050_i2c_num = -1; // i2c_default
+static unsigned char mpu6050_address = MPU6050_ADDRESS;
+static void (*mpu6050_bus_wait)(void) = 0;
+static float mpu6050_accel_scale = 1.0f / 16384; // g per LSB
+static float mpu6050_gyro_scale = 1.0f / 131;    // deg/s per LSB
+
+void mpu6050_set_port(int i2c_num, unsigned char address) {
+    mpu6050_i2c_num = i2c_num;
+    mpu6050_address = address;
+}
+
+void mpu6050_set_bus_wait(void (*wait)(void)) {
+    mpu6050_bus_wait = wait;
+}
+
+void mpu6050_write_register(uint8_t reg, uint8_t value) {
+    if (mpu6050_bus_wait) {
+        mpu6050_bus_wait();
+    }
+    mpu6050_port_write(reg, &value, 1);
+}
+
+uint8_t mpu6050_read_register(uint8_t reg) {
+    uint8_t value = 0;
+    if (mpu6050_bus_wait) {
+        mpu6050_bus_wait();
+    }
+    mpu6050_port_read(reg, &value, 1);
+    return value;
+}
+
+uint8_t mpu6050_who_am_i() {
+    return mpu6050_read_register(MPU6050_WHO_AM_I);
+}
+
+// LSB per deg/s from the datasheet, not quite halving every step
+static const float gyro_lsb[] = {131.0f, 65.5f, 32.8f, 16.4f};
+
+bool mpu6050_setup(mpu6050_accel_range_t accel, mpu6050_gyro_range_t gyro) {
+    mpu6050_port_init(mpu6050_i2c_num, mpu6050_address);
+    uint8_t who = mpu6050_who_am_i();
+    if (who != 0x68 && who != 0x98) { // 0x98 on some of the clones
+        return false;
+    }
+    mpu6050_write_register(MPU6050_PWR_MGMT_1, 0x00); // wake up, it starts in sleep
+    mpu6050_write_register(MPU6050_ACCEL_CONFIG, accel << 3);
+    mpu6050_write_register(MPU6050_GYRO_CONFIG, gyro << 3);
+    mpu6050_accel_scale = (float)(1 << accel) / 16384; // 16384 LSB/g at 2g, halves with every step
+    mpu6050_gyro_scale = 1.0f / gyro_lsb[gyro];
+    return true;
+}
+
+void mpu6050_parse(const uint8_t *buf, mpu6050_raw_t *raw) {
+    int i;
+    for (i = 0; i < 3; i++) {
+        raw->accel[i] = (int16_t)((buf[2*i] << 8) | buf[2*i + 1]);
+        raw->gyro[i] = (int16_t)((buf[8 + 2*i] << 8) | buf[8 + 2*i + 1]);
+    }
+    raw->temp = (int16_t)((buf[6] << 8) | buf[7]);
+}
+
+bool mpu6050_read(mpu6050_raw_t *raw) {
+    uint8_t buf[MPU6050_BURST_LEN];
+    if (mpu6050_bus_wait) {
+        mpu6050_bus_wait();
+    }
+    if (!mpu6050_port_read(MPU6050_ACCEL_XOUT_H, buf, MPU6050_BURST_LEN)) {
+        return false;
+    }
+    mpu6050_parse(buf, raw);
+    return true;
+}
+
+void mpu6050_scale(const mpu6050_raw_t *raw, mpu6050_sample_t *s) {
+    int i;
+    for (i = 0; i < 3; i++) {
+        s->accel[i] = raw->accel[i] * mpu6050_accel_scale;
+        s->gyro[i] = raw->gyro[i] * mpu6050_gyro_scale;
+    }
+    s->temp = raw->temp / 340.0f + 36.53f; // from the register map
+}
+
+float mpu6050_accel_lsb_per_g() {
+    return 1.0f / mpu6050_accel_scale;
+}
+
+float mpu6050_gyro_lsb_per_dps() {
+    return 1.0f / mpu6050_gyro_scale;
+}
+
+unsigned int mpu6050_start_fifo(unsigned int rate_hz, uint8_t dlpf) {
+    if (rate_hz < 4 || rate_hz > 1000 || dlpf < 1 || dlpf > 6) {
+        return 0;
+    }
+    uint8_t div = (uint8_t)(1000 / rate_hz - 1);
+    mpu6050_write_register(MPU6050_USER_CTRL, 0); // stop and empty it before changing the rate
+    mpu6050_write_register(MPU6050_USER_CTRL, MPU6050_USER_FIFO_RESET);
+    mpu6050_write_register(MPU6050_CONFIG, dlpf);
+    mpu6050_write_register(MPU6050_SMPLRT_DIV, div);
+    mpu6050_write_register(MPU6050_FIFO_EN, MPU6050_FIFO_EN_ACCEL | MPU6050_FIFO_EN_TEMP | MPU6050_FIFO_EN_GYRO);
+    // active high push-pull 50 us pulse, the status only clears when INT_STATUS itself is read.
+    // Data ready only, so every pulse on INT is one sample (imu_stream matches them up)
+    mpu6050_write_register(MPU6050_INT_PIN_CFG, 0);
+    mpu6050_write_register(MPU6050_INT_ENABLE, MPU6050_INT_DATA_RDY);
+    mpu6050_read_register(MPU6050_INT_STATUS); // nothing stale left over
+    mpu6050_write_register(MPU6050_USER_CTRL, MPU6050_USER_FIFO_EN);
+    return 1000 / (div + 1);
+}
+
+void mpu6050_stop_fifo() {
+    mpu6050_write_register(MPU6050_INT_ENABLE, 0);
+    mpu6050_write_register(MPU6050_FIFO_EN, 0);
+    mpu6050_write_register(MPU6050_USER_CTRL, MPU6050_USER_FIFO_RESET);
+}
+
+int mpu6050_fifo_count() {
+    uint8_t buf[2] = {0, 0};
+    if (mpu6050_bus_wait) {
+        mpu6050_bus_wait();
+    }
+    mpu6050_port_read(MPU6050_FIFO_COUNTH, buf, 2);
+    return (buf[0] << 8) | buf[1];
+}
+
+// a few samples per transfer, the FIFO register doesn't move so it is read like one long burst
+#define MPU6050_FIFO_CHUNK 8
+
+int mpu6050_fifo_samples() {
+    int count = mpu6050_fifo_count();
+    // the overflow interrupt is off, but a FIFO that overflowed stays full at 1024 bytes, more than
+    // whole samples fill (73 make 1022)
+    if (count > MPU6050_FIFO_SIZE - MPU6050_FIFO_SIZE % MPU6050_BURST_LEN) {
+        // the chip threw bytes away at the front, the samples in it don't start on a boundary any more
+        mpu6050_write_register(MPU6050_USER_CTRL, MPU6050_USER_FIFO_EN | MPU6050_USER_FIFO_RESET);
+        return -1;
+    }
+    return count / MPU6050_BURST_LEN;
+}
+
+int mpu6050_fifo_read(mpu6050_raw_t *raw, int n) {
+    uint8_t buf[MPU6050_FIFO_CHUNK * MPU6050_BURST_LEN];
+    int done = 0;
+    while (done < n) {
+        int chunk = n - done < MPU6050_FIFO_CHUNK ? n - done : MPU6050_FIFO_CHUNK;
+        if (mpu6050_bus_wait) {
+            mpu6050_bus_wait();
+        }
+        if (!mpu6050_port_read(MPU6050_FIFO_R_W, buf, chunk * MPU6050_BURST_LEN)) {
+            break;
+        }
+        int i;
+        for (i = 0; i < chunk; i++) {
+            mpu6050_parse(buf + i * MPU6050_BURST_LEN, &raw[done + i]);
+        }
+        done += chunk;
+    }
+    return done;
+}
+
+// START, address + register, repeated START, address, 14 data bytes, STOP. Every byte is
+// 9 clocks with its ack and the start/stop conditions take about a clock each
+float mpu6050_burst_us(unsigned int baud) {
+    int clocks = 9 * (3 + MPU6050_BURST_LEN) + 3;
+    return clocks * 1e6f / baud;
+}
@@ -0,0 +1,110 @@
+#ifndef MPU6050_H__
+#define MPU6050_H__
+
+// MPU6050 accelerometer and gyro. Every sample is one 14 byte burst from ACCEL_XOUT_H to
+// GYRO_ZOUT_L, the chip increments the register address itself and latches all seven
+// channels at the start of the read so they belong to the same sample
+//
+//   mpu6050_set_bus_wait(ssd1306_wait); // when the OLED DMA shares the bus
+//   if (!mpu6050_setup(MPU6050_ACCEL_2G, MPU6050_GYRO_2000DPS)) ... not found
+//   mpu6050_raw_t raw;
+//   mpu6050_sample_t s;
+//   if (mpu6050_read(&raw)) mpu6050_scale(&raw, &s);
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MPU6050_ADDRESS 0x68 // AD0 low
+
+// config registers
+#define MPU6050_SMPLRT_DIV   0x19
+#define MPU6050_CONFIG       0x1A // DLPF_CFG in bits 2:0
+#define MPU6050_GYRO_CONFIG  0x1B
+#define MPU6050_ACCEL_CONFIG 0x1C
+#define MPU6050_FIFO_EN      0x23
+#define MPU6050_INT_PIN_CFG  0x37
+#define MPU6050_INT_ENABLE   0x38
+#define MPU6050_INT_STATUS   0x3A
+#define MPU6050_USER_CTRL    0x6A
+#define MPU6050_PWR_MGMT_1   0x6B
+#define MPU6050_PWR_MGMT_2   0x6C
+#define MPU6050_FIFO_COUNTH  0x72
+#define MPU6050_FIFO_R_W     0x74
+#define MPU6050_WHO_AM_I     0x75
+
+// register bits the FIFO mode uses
+#define MPU6050_FIFO_EN_TEMP    0x80
+#define MPU6050_FIFO_EN_GYRO    0x70 // XG, YG, ZG
+#define MPU6050_FIFO_EN_ACCEL   0x08
+#define MPU6050_INT_RD_CLEAR    0x10 // INT_PIN_CFG, any read clears the interrupt status
+#define MPU6050_INT_DATA_RDY    0x01 // INT_ENABLE / INT_STATUS
+#define MPU6050_INT_FIFO_OFLOW  0x10
+#define MPU6050_USER_FIFO_EN    0x40
+#define MPU6050_USER_FIFO_RESET 0x04
+#define MPU6050_FIFO_SIZE       1024
+
+// sensor data registers, big endian pairs
+#define MPU6050_ACCEL_XOUT_H 0x3B
+#define MPU6050_TEMP_OUT_H   0x41
+#define MPU6050_GYRO_XOUT_H  0x43
+#define MPU6050_BURST_LEN    14 // ACCEL_XOUT_H .. GYRO_ZOUT_L
+
+// full scale, the value goes straight into ACCEL_CONFIG / GYRO_CONFIG bits 4:3
+typedef enum {
+    MPU6050_ACCEL_2G = 0,
+    MPU6050_ACCEL_4G,
+    MPU6050_ACCEL_8G,
+    MPU6050_ACCEL_16G,
+} mpu6050_accel_range_t;
+
+typedef enum {
+    MPU6050_GYRO_250DPS = 0,
+    MPU6050_GYRO_500DPS,
+    MPU6050_GYRO_1000DPS,
+    MPU6050_GYRO_2000DPS,
+} mpu6050_gyro_range_t;
+
+// one burst in register order, already swapped to the host byte order
+typedef struct __attribute__((packed)) {
+    int16_t accel[3]; // x, y, z
+    int16_t temp;
+    int16_t gyro[3];  // x, y, z
+} mpu6050_raw_t;
+
+typedef struct {
+    float accel[3]; // g
+    float temp;     // degrees C
+    float gyro[3];  // degrees/s
+} mpu6050_sample_t;
+
+// call these before mpu6050_setup(), the default is 0x68 on i2c_default
+void mpu6050_set_port(int i2c_num, unsigned char address); // i2c_num -1 means i2c_default
+void mpu6050_set_bus_wait(void (*wait)(void)); // called before every transfer, NULL for none
+
+bool mpu6050_setup(mpu6050_accel_range_t accel, mpu6050_gyro_range_t gyro); // false if WHO_AM_I is wrong
+uint8_t mpu6050_who_am_i(void);
+bool mpu6050_read(mpu6050_raw_t *raw); // one burst, false if the chip didn't answer
+void mpu6050_parse(const uint8_t *buf, mpu6050_raw_t *raw); // MPU6050_BURST_LEN bytes off the bus
+void mpu6050_scale(const mpu6050_raw_t *raw, mpu6050_sample_t *s);
+float mpu6050_accel_lsb_per_g(void);
+float mpu6050_gyro_lsb_per_dps(void);
+
+// FIFO mode: the chip samples at rate_hz on its own and queues every sample in the burst
+// layout (accel, temp, gyro, 14 bytes), INT pulses once per sample. dlpf is DLPF_CFG 1 to 6,
+// they all run the sampling off 1 kHz. Returns the rate it got, 0 if it can't do rate_hz
+unsigned int mpu6050_start_fifo(unsigned int rate_hz, uint8_t dlpf);
+void mpu6050_stop_fifo(void);
+int mpu6050_fifo_count(void); // bytes waiting
+// whole samples waiting, or -1 if the FIFO overflowed since the last call; then it is emptied
+// and starts clean on the next sample
+int mpu6050_fifo_samples(void);
+// reads n samples out of the FIFO, oldest first, n from mpu6050_fifo_samples(). Returns how many it got
+int mpu6050_fifo_read(mpu6050_raw_t *raw, int n);
+
+// time one burst keeps the bus busy at this clock, 1e6 / this is the most samples per second
+float mpu6050_burst_us(unsigned int baud);
+
+void mpu6050_write_register(uint8_t reg, uint8_t value);
+uint8_t mpu6050_read_register(uint8_t reg);
+
+#endif
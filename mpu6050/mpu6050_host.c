@@ -0,0 +1,116 @@
+// MPU6050 host port, a register file in place of the chip
+
+#include <string.h>
+#include "mpu6050_port.h"
+#include "mpu6050_host.h"
+
+static uint8_t regs[128];
+static uint8_t fifo[MPU6050_FIFO_SIZE];
+static int fifo_head = 0, fifo_len = 0; // oldest byte, bytes queued
+static unsigned long transactions = 0;
+static unsigned long bytes = 0;
+
+void mpu6050_host_reset() {
+    memset(regs, 0, sizeof(regs));
+    regs[MPU6050_WHO_AM_I] = 0x68;
+    regs[MPU6050_PWR_MGMT_1] = 0x40; // SLEEP
+    fifo_head = fifo_len = 0;
+    transactions = 0;
+    bytes = 0;
+}
+
+void mpu6050_port_init(int i2c_num, unsigned char address) {
+    (void) i2c_num;
+    (void) address;
+    if (regs[MPU6050_WHO_AM_I] == 0) { // nobody set it up, act like a fresh chip
+        mpu6050_host_reset();
+    }
+}
+
+bool mpu6050_port_write(uint8_t reg, const uint8_t *data, int n) {
+    int i;
+    for (i = 0; i < n; i++) {
+        regs[(reg + i) & 127] = data[i];
+    }
+    if (regs[MPU6050_USER_CTRL] & MPU6050_USER_FIFO_RESET) { // self clearing
+        regs[MPU6050_USER_CTRL] &= ~MPU6050_USER_FIFO_RESET;
+        fifo_head = fifo_len = 0;
+    }
+    transactions++;
+    bytes += n;
+    return true;
+}
+
+bool mpu6050_port_read(uint8_t reg, uint8_t *data, int n) {
+    int i;
+    for (i = 0; i < n; i++) {
+        uint8_t r = (reg + i) & 127;
+        if (reg == MPU6050_FIFO_R_W) { // the address stays put, every byte comes off the FIFO
+            r = MPU6050_FIFO_R_W;
+            if (fifo_len > 0) {
+                regs[MPU6050_FIFO_R_W] = fifo[fifo_head];
+                fifo_head = (fifo_head + 1) % MPU6050_FIFO_SIZE;
+                fifo_len--;
+            }
+        }
+        if (r == MPU6050_FIFO_COUNTH || r == MPU6050_FIFO_COUNTH + 1) {
+            regs[MPU6050_FIFO_COUNTH] = fifo_len >> 8;
+            regs[MPU6050_FIFO_COUNTH + 1] = fifo_len & 0xFF;
+        }
+        data[i] = regs[r];
+    }
+    // cleared when it is read, or by any read at all with INT_RD_CLEAR set
+    if ((reg <= MPU6050_INT_STATUS && reg + n > MPU6050_INT_STATUS) || (regs[MPU6050_INT_PIN_CFG] & MPU6050_INT_RD_CLEAR)) {
+        regs[MPU6050_INT_STATUS] = 0;
+    }
+    transactions++;
+    bytes += n;
+    return true;
+}
+
+void mpu6050_host_set_register(uint8_t reg, uint8_t value) {
+    regs[reg & 127] = value;
+}
+
+uint8_t mpu6050_host_register(uint8_t reg) {
+    return regs[reg & 127];
+}
+
+void mpu6050_host_load(const mpu6050_raw_t *raw) {
+    int16_t in[MPU6050_BURST_LEN / 2] = {raw->accel[0], raw->accel[1], raw->accel[2], raw->temp,
+                                         raw->gyro[0], raw->gyro[1], raw->gyro[2]};
+    int i;
+    for (i = 0; i < MPU6050_BURST_LEN / 2; i++) {
+        regs[MPU6050_ACCEL_XOUT_H + 2*i] = (uint8_t)((uint16_t)in[i] >> 8);
+        regs[MPU6050_ACCEL_XOUT_H + 2*i + 1] = (uint8_t)(in[i] & 0xFF);
+    }
+}
+
+void mpu6050_host_sample(const mpu6050_raw_t *raw) {
+    mpu6050_host_load(raw);
+    regs[MPU6050_INT_STATUS] |= MPU6050_INT_DATA_RDY;
+    if (!(regs[MPU6050_USER_CTRL] & MPU6050_USER_FIFO_EN) || regs[MPU6050_FIFO_EN] == 0) {
+        return;
+    }
+    // only the layout mpu6050_start_fifo() asks for: accel, temp and gyro, the whole burst
+    int i;
+    for (i = 0; i < MPU6050_BURST_LEN; i++) {
+        if (fifo_len == MPU6050_FIFO_SIZE) {
+            fifo_head = (fifo_head + 1) % MPU6050_FIFO_SIZE;
+            fifo_len--;
+            if (regs[MPU6050_INT_ENABLE] & MPU6050_INT_FIFO_OFLOW) {
+                regs[MPU6050_INT_STATUS] |= MPU6050_INT_FIFO_OFLOW;
+            }
+        }
+        fifo[(fifo_head + fifo_len) % MPU6050_FIFO_SIZE] = regs[MPU6050_ACCEL_XOUT_H + i];
+        fifo_len++;
+    }
+}
+
+unsigned long mpu6050_host_transactions() {
+    return transactions;
+}
+
+unsigned long mpu6050_host_bytes() {
+    return bytes;
+}
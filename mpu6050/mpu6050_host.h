@@ -0,0 +1,21 @@
+#ifndef MPU6050_HOST_H__
+#define MPU6050_HOST_H__
+
+// only in host builds: the port is a register file that answers like the chip does, burst
+// reads and writes walk the register address. Load a sample into it and mpu6050_read()
+// parses it the same way it parses the bus
+
+#include <stdint.h>
+#include "mpu6050.h"
+
+void mpu6050_host_reset(void); // power up values, WHO_AM_I 0x68 and asleep
+void mpu6050_host_set_register(uint8_t reg, uint8_t value);
+uint8_t mpu6050_host_register(uint8_t reg);
+void mpu6050_host_load(const mpu6050_raw_t *raw); // into ACCEL_XOUT_H .. GYRO_ZOUT_L, big endian
+// a new sample from the sensor: loaded into the data registers and, when the FIFO is on, queued
+// for FIFO_R_W. A full FIFO drops its oldest bytes and sets FIFO_OFLOW like the chip does
+void mpu6050_host_sample(const mpu6050_raw_t *raw);
+unsigned long mpu6050_host_transactions(void); // reads and writes so far
+unsigned long mpu6050_host_bytes(void);        // data bytes either way
+
+#endif
@@ -0,0 +1,32 @@
+// MPU6050 over the pico I2C block
+
+#include "mpu6050_port.h"
+#include "hardware/i2c.h"
+
+static i2c_inst_t *mpu6050_i2c = NULL;
+static unsigned char mpu6050_i2c_address;
+
+void mpu6050_port_init(int i2c_num, unsigned char address) {
+    mpu6050_i2c = i2c_num < 0 ? i2c_default : i2c_get_instance(i2c_num);
+    mpu6050_i2c_address = address;
+}
+
+bool mpu6050_port_write(uint8_t reg, const uint8_t *data, int n) {
+    uint8_t buf[1 + 16];
+    int i;
+    if (n > 16) {
+        return false;
+    }
+    buf[0] = reg;
+    for (i = 0; i < n; i++) {
+        buf[1 + i] = data[i];
+    }
+    return i2c_write_blocking(mpu6050_i2c, mpu6050_i2c_address, buf, 1 + n, false) == 1 + n;
+}
+
+bool mpu6050_port_read(uint8_t reg, uint8_t *data, int n) {
+    if (i2c_write_blocking(mpu6050_i2c, mpu6050_i2c_address, &reg, 1, true) != 1) { // keep the bus for the restart
+        return false;
+    }
+    return i2c_read_blocking(mpu6050_i2c, mpu6050_i2c_address, data, n, false) == n;
+}
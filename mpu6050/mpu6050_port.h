@@ -0,0 +1,14 @@
+#ifndef MPU6050_PORT_H__
+#define MPU6050_PORT_H__
+
+// what mpu6050.c needs from the bus, mpu6050_pico.c uses the pico I2C block and
+// mpu6050_host.c a register file that behaves like the chip
+
+#include <stdint.h>
+#include <stdbool.h>
+
+void mpu6050_port_init(int i2c_num, unsigned char address);
+bool mpu6050_port_write(uint8_t reg, const uint8_t *data, int n); // reg, then n bytes into reg, reg+1, ...
+bool mpu6050_port_read(uint8_t reg, uint8_t *data, int n);        // reg, repeated start, n bytes from reg, reg+1, ...
+
+#endif
@@ -0,0 +1,104 @@
+// fixed rate loop scheduler, see scheduler.h
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "scheduler.h"
+
+// alarm interrupt, just count and wake the loop
+static bool scheduler_tick(repeating_timer_t *rt) {
+    scheduler_t *s = (scheduler_t *)rt->user_data;
+    s->tick_time = time_us_64();
+    s->ticks++;
+    __sev(); // scheduler_wait sleeps in __wfe
+    return true;
+}
+
+// clear the statistics, only on the core that runs scheduler_wait
+static void scheduler_clear_stats(scheduler_t *s) {
+    s->runs = 0;
+    s->overruns = 0;
+    s->min_us = UINT32_MAX;
+    s->max_us = 0;
+    s->sum_us = 0;
+    s->late_max_us = 0;
+    s->reset_pending = false;
+}
+
+bool scheduler_init(scheduler_t *s, uint32_t period_us) {
+    s->period_us = period_us;
+    s->ticks = 0;
+    s->taken = 0;
+    scheduler_clear_stats(s);
+    // a negative delay means fixed rate: the next alarm is set from the last alarm, not from when the callback ran
+    return add_repeating_timer_us(-(int64_t)period_us, scheduler_tick, s, &s->timer);
+}
+
+void scheduler_stop(scheduler_t *s) {
+    cancel_repeating_timer(&s->timer);
+}
+
+// safe from any core: the loop clears the statistics itself on its next scheduler_wait, so a
+// reset can't land in the middle of it updating them
+void scheduler_reset_stats(scheduler_t *s) {
+    s->reset_pending = true;
+}
+
+// block until the next tick
+void scheduler_wait(scheduler_t *s) {
+    while (s->ticks == s->taken) {
+        __wfe();
+    }
+    uint64_t now = time_us_64();
+    if (s->reset_pending) {
+        scheduler_clear_stats(s); // this step starts the new statistics
+    }
+    uint32_t ticks = s->ticks;
+    s->overruns += ticks - s->taken - 1; // more than one tick since the last step started
+    s->taken = ticks;
+
+    uint32_t late = (uint32_t)(now - s->tick_time);
+    if (late > s->late_max_us) s->late_max_us = late;
+    if (s->runs > 0) {
+        uint32_t period = (uint32_t)(now - s->last_start);
+        if (period < s->min_us) s->min_us = period;
+        if (period > s->max_us) s->max_us = period;
+        s->sum_us += period;
+    }
+    s->last_start = now;
+    s->runs++;
+}
+
+uint32_t scheduler_mean_us(const scheduler_t *s) {
+    if (s->runs < 2) {
+        return 0;
+    }
+    return (uint32_t)(s->sum_us / (s->runs - 1));
+}
+
+// the fields are read without a lock, fine for a report from the other core
+void scheduler_report(const scheduler_t *s, const char *name) {
+    printf("%s: period %" PRIu32 " us, min %" PRIu32 " max %" PRIu32 " mean %" PRIu32 " us, late max %" PRIu32 " us, runs %" PRIu32
+           " overruns %" PRIu32 "\r\n",
+           name, s->period_us, s->runs > 1 ? s->min_us : 0, s->max_us, scheduler_mean_us(s),
+           s->late_max_us, s->runs, s->overruns);
+}
+
+// run one USB command character, returns false if it isn't one of ours so the caller can use it
+bool scheduler_command(scheduler_t *s, const char *name, int c) {
+    if (c == 's') {
+        scheduler_report(s, name);
+        return true;
+    }
+    if (c == 'r') {
+        scheduler_reset_stats(s);
+        printf("%s: statistics reset\r\n", name);
+        return true;
+    }
+    return false;
+}
+
+bool scheduler_poll_usb(scheduler_t *s, const char *name) {
+    return scheduler_command(s, name, getchar_timeout_us(0));
+}
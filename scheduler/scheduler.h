@@ -0,0 +1,50 @@
+#ifndef SCHEDULER_H__
+#define SCHEDULER_H__
+
+// fixed rate loops paced by a hardware alarm instead of sleep_ms
+//
+//   scheduler_t sched;
+//   scheduler_init(&sched, 10000); // 100 Hz
+//   while (true) {
+//       scheduler_wait(&sched); // returns once per period, on the alarm
+//       ... control step ...
+//   }
+//
+// the alarm only counts ticks, the work still runs in the loop so it can use the blocking
+// I2C/SPI calls. A step that runs past the next tick is an overrun, the missed ticks are
+// dropped rather than run back to back to catch up
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/time.h"
+
+typedef struct {
+    uint32_t period_us;
+    repeating_timer_t timer;
+    volatile uint32_t ticks; // bumped by the alarm
+    uint32_t taken;          // ticks the loop has seen
+
+    // statistics since the last reset, the period is measured between returns of scheduler_wait
+    uint32_t runs;
+    uint32_t overruns;       // ticks missed because the last step was still running
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t late_max_us;    // worst delay from the alarm to scheduler_wait returning
+    uint64_t last_start;
+    volatile uint64_t tick_time;
+    volatile bool reset_pending; // scheduler_reset_stats asked, scheduler_wait clears
+} scheduler_t;
+
+bool scheduler_init(scheduler_t *s, uint32_t period_us);
+void scheduler_stop(scheduler_t *s);
+void scheduler_wait(scheduler_t *s);
+void scheduler_reset_stats(scheduler_t *s); // takes effect on the next scheduler_wait
+uint32_t scheduler_mean_us(const scheduler_t *s);
+
+// statistics over USB: 's' prints them and 'r' resets them, checks stdin without blocking
+void scheduler_report(const scheduler_t *s, const char *name);
+bool scheduler_poll_usb(scheduler_t *s, const char *name);
+bool scheduler_command(scheduler_t *s, const char *name, int c); // for loops that read stdin themselves
+
+#endif
@@ -0,0 +1,466 @@
+// based on adafruit and sparkfun libraries
+
+#include <string.h> // for memset
+#include "ssd1306.h"
+#include "ssd1306_port.h"
+#include "font.h"
+
+static unsigned char ssd1306_height_px = 32;
+static int ssd1306_i2c_num = -1; // i2c_default
+static unsigned char ssd1306_address = 0b0111100; // 7bit i2c address
+
+// one byte per column and 8 rows per byte, page after page. Always 128 columns wide
+static unsigned char ssd1306_buffer[SSD1306_WIDTH * SSD1306_MAX_PAGES];
+
+// ssd1306_update() builds the I2C stream in here and the port sends it while the next frame gets drawn
+#define SSD1306_TX_LEN (SSD1306_MAX_PAGES * (7 + 1 + SSD1306_WIDTH)) // worst case, every page gets its own window
+static uint16_t ssd1306_tx[SSD1306_TX_LEN];
+
+// only the columns that were drawn on get sent. Every page keeps the range of columns touched
+// since the last update (min > max means clean) and ssd1306_sent remembers what the display shows
+static unsigned char ssd1306_sent[SSD1306_WIDTH * SSD1306_MAX_PAGES];
+static unsigned char ssd1306_dirty_min[SSD1306_MAX_PAGES];
+static unsigned char ssd1306_dirty_max[SSD1306_MAX_PAGES];
+static bool ssd1306_resend = true; // display RAM is unknown after power up
+static unsigned int ssd1306_last_bytes = 0;
+static unsigned long ssd1306_total_bytes = 0;
+
+static inline int ssd1306_pages() {
+    return ssd1306_height_px / 8;
+}
+
+static inline void ssd1306_mark_dirty(int page, int first, int last) {
+    if (first < ssd1306_dirty_min[page]) {
+        ssd1306_dirty_min[page] = first;
+    }
+    if (last > ssd1306_dirty_max[page]) {
+        ssd1306_dirty_max[page] = last;
+    }
+}
+
+bool ssd1306_set_height(unsigned char height) {
+    if (height != 32 && height != 64) {
+        return false;
+    }
+    ssd1306_height_px = height;
+    return true;
+}
+
+void ssd1306_set_port(int i2c_num, unsigned char address) {
+    ssd1306_i2c_num = i2c_num;
+    ssd1306_address = address;
+}
+
+unsigned char ssd1306_width() {
+    return SSD1306_WIDTH;
+}
+
+unsigned char ssd1306_height() {
+    return ssd1306_height_px;
+}
+
+void ssd1306_setup() {
+    ssd1306_invalidate();
+    ssd1306_port_init(ssd1306_i2c_num, ssd1306_address);
+    // give a little delay for the ssd1306 to power up
+    ssd1306_port_delay_ms(20);
+    ssd1306_command(SSD1306_DISPLAYOFF);
+    ssd1306_command(SSD1306_SETDISPLAYCLOCKDIV);
+    ssd1306_command(0x80);
+    ssd1306_command(SSD1306_SETMULTIPLEX);
+    ssd1306_command(ssd1306_height_px - 1);
+    ssd1306_command(SSD1306_SETDISPLAYOFFSET);
+    ssd1306_command(0x0);
+    ssd1306_command(SSD1306_SETSTARTLINE);
+    ssd1306_command(SSD1306_CHARGEPUMP);
+    ssd1306_command(0x14);
+    ssd1306_command(SSD1306_MEMORYMODE);
+    ssd1306_command(0x00);
+    ssd1306_command(SSD1306_SEGREMAP | 0x1);
+    ssd1306_command(SSD1306_COMSCANDEC);
+    ssd1306_command(SSD1306_SETCOMPINS);
+    ssd1306_command(ssd1306_height_px == 64 ? 0x12 : 0x02); // 64 row panels use alternate COM pins
+    ssd1306_command(SSD1306_SETCONTRAST);
+    ssd1306_command(0x8F);
+    ssd1306_command(SSD1306_SETPRECHARGE);
+    ssd1306_command(0xF1);
+    ssd1306_command(SSD1306_SETVCOMDETECT);
+    ssd1306_command(0x40);
+    ssd1306_command(SSD1306_DISPLAYON);
+    ssd1306_clear();
+    ssd1306_update();
+}
+
+// send a command instruction (not pixel data)
+void ssd1306_command(unsigned char c) {
+    ssd1306_wait(); // can't mix with a flush in progress
+    ssd1306_port_command(c);
+}
+
+// add the bytes of one page between first and last that differ from the display to the tx stream
+// force sends the whole range, for when we don't know what the display shows
+static int ssd1306_queue(int n, int page, int first, int last, bool force) {
+    unsigned char *now = &ssd1306_buffer[page*SSD1306_WIDTH];
+    unsigned char *sent = &ssd1306_sent[page*SSD1306_WIDTH];
+    if (!force) {
+        // redrawing the same text doesn't count, trim to the bytes that really changed
+        while (first <= last && now[first] == sent[first]) {
+            first++;
+        }
+        while (last >= first && now[last] == sent[last]) {
+            last--;
+        }
+    }
+    if (first > last) {
+        return n;
+    }
+
+    // command transaction: control byte 0x00 (every byte after it is a command), then the address window
+    ssd1306_tx[n++] = 0x00;
+    ssd1306_tx[n++] = SSD1306_PAGEADDR;
+    ssd1306_tx[n++] = page;
+    ssd1306_tx[n++] = page;
+    ssd1306_tx[n++] = SSD1306_COLUMNADDR;
+    ssd1306_tx[n++] = first;
+    ssd1306_tx[n++] = last | SSD1306_TX_STOP;
+
+    // data transaction: control byte 0x40 then the columns of this page
+    ssd1306_tx[n++] = 0x40;
+    int i;
+    for (i = first; i <= last; i++) {
+        ssd1306_tx[n++] = now[i];
+        sent[i] = now[i];
+    }
+    ssd1306_tx[n - 1] |= SSD1306_TX_STOP;
+    return n;
+}
+
+static void ssd1306_send(int n) {
+    ssd1306_last_bytes = n;
+    ssd1306_total_bytes += n;
+    if (n > 0) {
+        ssd1306_port_send(ssd1306_tx, n);
+    }
+}
+
+// send the parts of the screen that changed since the last update
+// starts the transfer and returns, call ssd1306_wait() before using the I2C bus for anything else
+void ssd1306_update() {
+    ssd1306_wait(); // the last flush is still reading ssd1306_tx
+
+    int n = 0;
+    int page;
+    for (page = 0; page < ssd1306_pages(); page++) {
+        int first = ssd1306_dirty_min[page];
+        int last = ssd1306_dirty_max[page];
+        ssd1306_dirty_min[page] = SSD1306_WIDTH - 1;
+        ssd1306_dirty_max[page] = 0;
+        n = ssd1306_queue(n, page, first, last, ssd1306_resend);
+    }
+    ssd1306_resend = false;
+    ssd1306_send(n);
+}
+
+// send just one block of the screen, whatever else was drawn waits for the next update
+void ssd1306_update_area(const ssd1306_area_t *area) {
+    ssd1306_wait();
+
+    int last_page = area->end_page;
+    if (last_page >= ssd1306_pages()) {
+        last_page = ssd1306_pages() - 1;
+    }
+    int last_col = area->end_col < SSD1306_WIDTH ? area->end_col : SSD1306_WIDTH - 1;
+    int n = 0;
+    int page;
+    for (page = area->start_page; page <= last_page; page++) {
+        n = ssd1306_queue(n, page, area->start_col, last_col, ssd1306_resend);
+    }
+    ssd1306_send(n);
+}
+
+// bytes a buffer for this area needs
+int ssd1306_area_len(const ssd1306_area_t *area) {
+    return (area->end_col - area->start_col + 1) * (area->end_page - area->start_page + 1);
+}
+
+// copy a page format image into the framebuffer, call an update to show it
+void ssd1306_blit(const unsigned char *buf, const ssd1306_area_t *area) {
+    int cols = area->end_col - area->start_col + 1;
+    int page;
+    for (page = area->start_page; page <= area->end_page && page < ssd1306_pages(); page++) {
+        int n = cols;
+        if (area->start_col + n > SSD1306_WIDTH) {
+            n = SSD1306_WIDTH - area->start_col;
+        }
+        if (n > 0) {
+            memcpy(&ssd1306_buffer[page*SSD1306_WIDTH + area->start_col], buf, n);
+            ssd1306_mark_dirty(page, area->start_col, area->start_col + n - 1);
+        }
+        buf += cols;
+    }
+}
+
+// forget what the display shows, the next update sends every pixel
+void ssd1306_invalidate() {
+    int page;
+    for (page = 0; page < SSD1306_MAX_PAGES; page++) {
+        ssd1306_dirty_min[page] = 0;
+        ssd1306_dirty_max[page] = SSD1306_WIDTH - 1;
+    }
+    ssd1306_resend = true;
+}
+
+// bytes written to the I2C bus by the last update (control and window commands included),
+// a full 128x32 screen is 4*(8+128) = 544 so anything less is bandwidth saved
+unsigned int ssd1306_bytes_sent() {
+    return ssd1306_last_bytes;
+}
+
+// bytes written by every update since power up
+unsigned long ssd1306_total_bytes_sent() {
+    return ssd1306_total_bytes;
+}
+
+// set a pixel value. Call update() to push to the display)
+void ssd1306_drawPixel(unsigned char x, unsigned char y, unsigned char color) {
+    if ((x >= SSD1306_WIDTH) || (y >= ssd1306_height_px)) {
+        return;
+    }
+
+    if (color == 1) {
+        ssd1306_buffer[x + (y / 8)*SSD1306_WIDTH] |= (1 << (y & 7));
+    } else {
+        ssd1306_buffer[x + (y / 8)*SSD1306_WIDTH] &= ~(1 << (y & 7));
+    }
+    ssd1306_mark_dirty(y / 8, x, x);
+}
+
+// Cohen-Sutherland outcodes against the screen
+#define CLIP_LEFT   1
+#define CLIP_RIGHT  2
+#define CLIP_TOP    4
+#define CLIP_BOTTOM 8
+
+static inline int ssd1306_outcode(int x, int y) {
+    return (x < 0 ? CLIP_LEFT : 0) | (x >= SSD1306_WIDTH ? CLIP_RIGHT : 0)
+         | (y < 0 ? CLIP_TOP : 0) | (y >= ssd1306_height_px ? CLIP_BOTTOM : 0);
+}
+
+// steps k of the major axis where the minor axis, at minor0 + floor((2*minor*k + major) / (2*major)),
+// stays within lo..hi. Narrows *first..*last, false if nothing is left
+static bool ssd1306_clip_minor(long long minor0, int s, long long major, long long minor, int lo, int hi,
+                               long long *first, long long *last) {
+    long long a = s > 0 ? lo - minor0 : minor0 - hi; // the minor axis has to move by a..b steps
+    long long b = s > 0 ? hi - minor0 : minor0 - lo;
+    if (b < 0) {
+        return false;
+    }
+    if (minor == 0) {
+        return a <= 0;
+    }
+    if (a > 0) { // first k with floor(...) >= a
+        long long k = (2*major*a - major + 2*minor - 1) / (2*minor);
+        if (k > *first) *first = k;
+    }
+    long long k = (2*major*(b + 1) - major - 1) / (2*minor); // last k with floor(...) <= b
+    if (k < *last) *last = k;
+    return *first <= *last;
+}
+
+// Bresenham clipped to the screen: the same pixels as stepping the whole line and dropping the
+// ones off screen, but it starts at the first visible step instead of walking there, and never
+// touches more than a screen's width of pixels however long the line is
+void ssd1306_draw_line(int x0, int y0, int x1, int y1, unsigned char color) {
+    int code0 = ssd1306_outcode(x0, y0), code1 = ssd1306_outcode(x1, y1);
+    if (code0 & code1) {
+        return; // both ends off the same side
+    }
+    long long dx = x1 > x0 ? (long long)x1 - x0 : (long long)x0 - x1;
+    long long dy = y1 > y0 ? (long long)y1 - y0 : (long long)y0 - y1;
+    int sx = (x0 < x1) ? 1 : -1;
+    int sy = (y0 < y1) ? 1 : -1;
+    bool steep = dy > dx; // y is the major axis
+    long long major = steep ? dy : dx, minor = steep ? dx : dy;
+    long long first = 0, last = major;
+    if (code0 | code1) {
+        // the major axis clips directly, the minor axis through the step that first/last reaches it
+        int smaj = steep ? sy : sx, smin = steep ? sx : sy;
+        long long maj0 = steep ? y0 : x0;
+        long long lo = 0, hi = (steep ? ssd1306_height_px : SSD1306_WIDTH) - 1;
+        long long a = smaj > 0 ? lo - maj0 : maj0 - hi, b = smaj > 0 ? hi - maj0 : maj0 - lo;
+        if (a > first) first = a;
+        if (b < last) last = b;
+        if (first > last || !ssd1306_clip_minor(steep ? x0 : y0, smin, major, minor, 0,
+                                                (steep ? SSD1306_WIDTH : ssd1306_height_px) - 1, &first, &last)) {
+            return;
+        }
+    }
+
+    // step first..last, the minor axis moves when the remainder passes 2*major
+    long long m = major ? (2*minor*first + major) / (2*major) : 0;
+    long long e = 2*minor*first + major - 2*major*m;
+    int x = x0 + (int)(steep ? sx*m : sx*first);
+    int y = y0 + (int)(steep ? sy*first : sy*m);
+    int page_dirty = -1, dirty_first = 0, dirty_last = 0;
+    long long k;
+    for (k = first; k <= last; k++) {
+        unsigned char *b = &ssd1306_buffer[x + (y / 8)*SSD1306_WIDTH];
+        if (color == 1) {
+            *b |= (1 << (y & 7));
+        } else {
+            *b &= ~(1 << (y & 7));
+        }
+        // one dirty range per run of pixels on the same page
+        if (y / 8 != page_dirty) {
+            if (page_dirty >= 0) {
+                ssd1306_mark_dirty(page_dirty, dirty_first < dirty_last ? dirty_first : dirty_last,
+                                   dirty_first < dirty_last ? dirty_last : dirty_first);
+            }
+            page_dirty = y / 8;
+            dirty_first = x;
+        }
+        dirty_last = x;
+
+        e += 2*minor;
+        bool step_minor = e >= 2*major;
+        if (step_minor) {
+            e -= 2*major;
+        }
+        if (steep) {
+            y += sy;
+            if (step_minor) x += sx;
+        } else {
+            x += sx;
+            if (step_minor) y += sy;
+        }
+    }
+    if (page_dirty >= 0) {
+        ssd1306_mark_dirty(page_dirty, dirty_first < dirty_last ? dirty_first : dirty_last,
+                           dirty_first < dirty_last ? dirty_last : dirty_first);
+    }
+}
+
+// floor(n / (2^20 * sqrt(d))) for n >= 0, at most max. Squared so there is no square root
+static int ssd1306_div_length(unsigned long long n, unsigned long long d, int max) {
+    int k = 0;
+    while (k < max && (unsigned long long)(k + 1) * (k + 1) * d << 40 <= n * n) {
+        k++;
+    }
+    return k;
+}
+
+// head * v / |(dx, dy)| rounded towards zero, v is a Q20 combination of dx and dy
+static int ssd1306_head_offset(long long v, long long dx, long long dy, int head) {
+    unsigned long long n = (unsigned long long)(v < 0 ? -v : v) * head;
+    int k = ssd1306_div_length(n, (unsigned long long)(dx*dx + dy*dy), head);
+    return v < 0 ? -k : k;
+}
+
+#define SSD1306_COS30_Q20 908093 // cos(30 deg) * 2^20
+#define SSD1306_SIN30_Q20 524288
+
+// the barbs are head pixels long at 30 degrees either side of the shaft. The direction only needs
+// the ratio of dx to dy, so instead of atan2/cos/sin the rotation by 30 degrees is done on the
+// vector and its length divided out with integer compares
+void ssd1306_draw_arrow(int x0, int y0, int x1, int y1, int head, unsigned char color) {
+    ssd1306_draw_line(x0, y0, x1, y1, color);
+    if (head <= 0) {
+        return;
+    }
+    if (head > SSD1306_MAX_ARROW_HEAD) {
+        head = SSD1306_MAX_ARROW_HEAD;
+    }
+    long long dx = (long long)x1 - x0, dy = (long long)y1 - y0;
+    if (dx == 0 && dy == 0) {
+        dx = 1; // no direction, point it right like atan2(0, 0) = 0 does
+    }
+    while (dx > 128 || dx < -128 || dy > 128 || dy < -128) {
+        dx /= 2; // keeps the squares in 64 bits, the direction hardly changes
+        dy /= 2;
+    }
+    // cos/sin(angle -+ 30 deg) times the length, angle being the direction of the shaft
+    long long c_minus = dx * SSD1306_COS30_Q20 + dy * SSD1306_SIN30_Q20;
+    long long s_minus = dy * SSD1306_COS30_Q20 - dx * SSD1306_SIN30_Q20;
+    long long c_plus = dx * SSD1306_COS30_Q20 - dy * SSD1306_SIN30_Q20;
+    long long s_plus = dy * SSD1306_COS30_Q20 + dx * SSD1306_SIN30_Q20;
+    ssd1306_draw_line(x1, y1, x1 - ssd1306_head_offset(c_minus, dx, dy, head),
+                      y1 - ssd1306_head_offset(s_minus, dx, dy, head), color);
+    ssd1306_draw_line(x1, y1, x1 - ssd1306_head_offset(c_plus, dx, dy, head),
+                      y1 - ssd1306_head_offset(s_plus, dx, dy, head), color);
+}
+
+// zero every pixel value the screen won't change until you call the update function
+void ssd1306_clear() {
+    memset(ssd1306_buffer, 0, sizeof(ssd1306_buffer)); // make every bit a 0, memset in string.h
+    int page;
+    for (page = 0; page < ssd1306_pages(); page++) {
+        ssd1306_mark_dirty(page, 0, SSD1306_WIDTH - 1); // update() trims this back to what was actually on screen
+    }
+}
+
+// draw one 5x8 character with its top left corner at x,y. The font columns are already in page
+// format (bit 0 on top) so they are copied straight into the buffer instead of pixel by pixel,
+// one byte per column when y is on a page boundary, otherwise split across two pages
+void ssd1306_draw_char(int x, int y, char c) {
+    int index = c - 0x20; // font starts at the space character
+    if (index < 0 || index >= 96) return; // skip unprintables
+    if (y <= -8 || y >= ssd1306_height_px || x <= -SSD1306_FONT_W || x >= SSD1306_WIDTH) return;
+
+    int page = (y + 8) / 8 - 1; // rounds down for y < 0 too
+    int shift = (y + 8) % 8;
+    int first = x < 0 ? -x : 0;
+    int last = x + SSD1306_FONT_W > SSD1306_WIDTH ? SSD1306_WIDTH - 1 - x : SSD1306_FONT_W - 1;
+    const char *glyph = ASCII[index];
+    int i;
+
+    if (shift == 0) {
+        unsigned char *dst = &ssd1306_buffer[page*SSD1306_WIDTH + x];
+        for (i = first; i <= last; i++) {
+            dst[i] = glyph[i];
+        }
+        ssd1306_mark_dirty(page, x + first, x + last);
+        return;
+    }
+
+    // top part of the glyph goes in the bottom of page, the rest in the top of page + 1
+    unsigned char keep_top = 0xFF >> (8 - shift);
+    unsigned char keep_bottom = 0xFF << shift;
+    if (page >= 0) {
+        unsigned char *dst = &ssd1306_buffer[page*SSD1306_WIDTH + x];
+        for (i = first; i <= last; i++) {
+            dst[i] = (dst[i] & keep_top) | (unsigned char)(glyph[i] << shift);
+        }
+        ssd1306_mark_dirty(page, x + first, x + last);
+    }
+    if (page + 1 < ssd1306_pages()) {
+        unsigned char *dst = &ssd1306_buffer[(page + 1)*SSD1306_WIDTH + x];
+        for (i = first; i <= last; i++) {
+            dst[i] = (dst[i] & keep_bottom) | ((unsigned char)glyph[i] >> (8 - shift));
+        }
+        ssd1306_mark_dirty(page + 1, x + first, x + last);
+    }
+}
+
+// draw a string, wrapping back to x on the next text row when it runs off the right edge
+// returns how many characters fit on the screen
+int ssd1306_draw_string(int x, int y, const char *m) {
+    int i = 0;
+    int startX = x;
+    while (m[i] != '\0') {
+        if (x + SSD1306_FONT_W >= SSD1306_WIDTH) {
+            x = startX;
+            y += SSD1306_FONT_H;
+            if (y + SSD1306_FONT_H > ssd1306_height_px) break; // Don't draw below the screen
+        }
+        ssd1306_draw_char(x, y, m[i]);
+        x += SSD1306_FONT_ADVANCE;
+        i++;
+    }
+    return i;
+}
+
+// width in pixels of a string drawn on one row, no spacing after the last character
+int ssd1306_string_width(const char *m) {
+    int n = strlen(m);
+    return n > 0 ? n*SSD1306_FONT_ADVANCE - 1 : 0;
+}
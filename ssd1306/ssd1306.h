@@ -0,0 +1,76 @@
+#ifndef SSD1306_H__
+#define SSD1306_H__
+
+// Based on the adafruit and sparkfun libraries
+#define SSD1306_MEMORYMODE          0x20
+#define SSD1306_COLUMNADDR          0x21
+#define SSD1306_PAGEADDR            0x22
+#define SSD1306_SETCONTRAST         0x81
+#define SSD1306_CHARGEPUMP          0x8D
+#define SSD1306_SEGREMAP            0xA0
+#define SSD1306_DISPLAYALLON_RESUME 0xA4
+#define SSD1306_NORMALDISPLAY       0xA6
+#define SSD1306_INVERTDISPLAY       0xA7
+#define SSD1306_SETMULTIPLEX        0xA8
+#define SSD1306_DISPLAYOFF          0xAE
+#define SSD1306_DISPLAYON           0xAF
+#define SSD1306_COMSCANDEC          0xC8
+#define SSD1306_SETDISPLAYOFFSET    0xD3
+#define SSD1306_SETDISPLAYCLOCKDIV  0xD5
+#define SSD1306_SETPRECHARGE        0xD9
+#define SSD1306_SETCOMPINS          0xDA
+#define SSD1306_SETVCOMDETECT       0xDB
+#define SSD1306_SETSTARTLINE        0x40
+#define SSD1306_DEACTIVATE_SCROLL   0x2E ///< Stop scroll
+
+#define SSD1306_WIDTH      128 // every supported panel is 128 columns wide
+#define SSD1306_MAX_HEIGHT 64
+#define SSD1306_MAX_PAGES  (SSD1306_MAX_HEIGHT / 8) // 8 rows per page
+
+// font.h characters
+#define SSD1306_FONT_W       5
+#define SSD1306_FONT_H       8
+#define SSD1306_FONT_ADVANCE 6 // 5 pixels + 1 spacing
+
+#include <stdbool.h>
+
+// a block of the screen in display memory units, columns 0-127 and pages of 8 rows (inclusive)
+typedef struct {
+    unsigned char start_col;
+    unsigned char end_col;
+    unsigned char start_page;
+    unsigned char end_page;
+} ssd1306_area_t;
+
+// call these before ssd1306_setup(), the default is a 128x32 panel at 0x3C on i2c_default
+bool ssd1306_set_height(unsigned char height); // 32 or 64
+void ssd1306_set_port(int i2c_num, unsigned char address); // i2c_num -1 means i2c_default
+unsigned char ssd1306_width(void);
+unsigned char ssd1306_height(void);
+
+void ssd1306_setup(void);
+void ssd1306_update(void);
+bool ssd1306_busy(void);
+void ssd1306_wait(void);
+void ssd1306_invalidate(void);
+unsigned int ssd1306_bytes_sent(void);
+unsigned long ssd1306_total_bytes_sent(void);
+void ssd1306_clear(void);
+void ssd1306_drawPixel(unsigned char x, unsigned char y, unsigned char color);
+void ssd1306_draw_line(int x0, int y0, int x1, int y1, unsigned char color); // clipped, any coordinates
+// line from x0,y0 with two barbs at x1,y1, head pixels long at 30 degrees to it
+#define SSD1306_MAX_ARROW_HEAD 15
+void ssd1306_draw_arrow(int x0, int y0, int x1, int y1, int head, unsigned char color);
+void ssd1306_draw_char(int x, int y, char c);
+int ssd1306_draw_string(int x, int y, const char *m);
+int ssd1306_string_width(const char *m);
+
+// render areas, buf is in display memory order: one byte per column, 8 rows per byte, page after page
+int ssd1306_area_len(const ssd1306_area_t *area);
+void ssd1306_blit(const unsigned char *buf, const ssd1306_area_t *area);
+void ssd1306_update_area(const ssd1306_area_t *area);
+
+/// this should be private
+void ssd1306_command(unsigned char c);
+
+#endif
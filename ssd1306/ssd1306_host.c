@@ -0,0 +1,112 @@
+// SSD1306 host port, there is no bus so the command stream is played into a copy of the display memory
+
+#include <stdio.h>
+#include <string.h>
+#include "ssd1306.h"
+#include "ssd1306_port.h"
+#include "ssd1306_host.h"
+
+static unsigned char gddram[SSD1306_MAX_PAGES][SSD1306_WIDTH];
+static int page_start = 0, page_end = SSD1306_MAX_PAGES - 1, page_ptr = 0;
+static int col_start = 0, col_end = SSD1306_WIDTH - 1, col_ptr = 0;
+static int pending = 0; // argument bytes still owed to PAGEADDR/COLUMNADDR
+static unsigned char pending_cmd;
+
+void ssd1306_port_init(int i2c_num, unsigned char address) {
+    (void) i2c_num;
+    (void) address;
+    memset(gddram, 0, sizeof(gddram));
+}
+
+// horizontal addressing mode, the only one ssd1306_setup() uses
+static void command_byte(unsigned char c) {
+    if (pending > 0) {
+        int first_arg = (pending == 2);
+        pending--;
+        if (pending_cmd == SSD1306_PAGEADDR) {
+            if (first_arg) {
+                page_start = page_ptr = c & 7;
+            } else {
+                page_end = c & 7;
+            }
+        } else {
+            if (first_arg) {
+                col_start = col_ptr = c & 127;
+            } else {
+                col_end = c & 127;
+            }
+        }
+        return;
+    }
+    if (c == SSD1306_PAGEADDR || c == SSD1306_COLUMNADDR) {
+        pending_cmd = c;
+        pending = 2;
+    }
+}
+
+static void data_byte(unsigned char d) {
+    gddram[page_ptr][col_ptr] = d;
+    if (col_ptr == col_end) {
+        col_ptr = col_start;
+        page_ptr = (page_ptr == page_end) ? page_start : page_ptr + 1;
+    } else {
+        col_ptr = (col_ptr + 1) & 127;
+    }
+}
+
+void ssd1306_port_command(unsigned char c) {
+    command_byte(c);
+}
+
+// every transaction starts with a control byte, 0x00 for commands and 0x40 for data
+void ssd1306_port_send(const uint16_t *tx, int n) {
+    int i;
+    int control = -1;
+    for (i = 0; i < n; i++) {
+        unsigned char b = tx[i] & 0xFF;
+        if (control < 0) {
+            control = b;
+        } else if (control & 0x40) {
+            data_byte(b);
+        } else {
+            command_byte(b);
+        }
+        if (tx[i] & SSD1306_TX_STOP) {
+            control = -1;
+        }
+    }
+}
+
+void ssd1306_port_delay_ms(unsigned int ms) {
+    (void) ms;
+}
+
+bool ssd1306_busy() {
+    return false;
+}
+
+void ssd1306_wait() {
+}
+
+int ssd1306_display_pixel(int x, int y) {
+    if (x < 0 || x >= SSD1306_WIDTH || y < 0 || y >= ssd1306_height()) {
+        return 0;
+    }
+    return (gddram[y / 8][x] >> (y & 7)) & 1;
+}
+
+int ssd1306_write_pbm(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    int x, y;
+    fprintf(f, "P1\n%d %d\n", SSD1306_WIDTH, ssd1306_height());
+    for (y = 0; y < ssd1306_height(); y++) {
+        for (x = 0; x < SSD1306_WIDTH; x++) {
+            fputc(ssd1306_display_pixel(x, y) ? '1' : '0', f);
+            fputc(x == SSD1306_WIDTH - 1 ? '\n' : ' ', f);
+        }
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
@@ -0,0 +1,13 @@
+#ifndef SSD1306_HOST_H__
+#define SSD1306_HOST_H__
+
+// only in host builds: the port keeps its own copy of the display memory, filled from
+// the same command stream the pico sends, so a picture of it shows what the panel would show
+
+// write the display as a plain PBM image (1 = lit), returns 0 or -1 if the file can't be written
+int ssd1306_write_pbm(const char *path);
+
+// lit or not, straight from the emulated display memory
+int ssd1306_display_pixel(int x, int y);
+
+#endif
@@ -0,0 +1,79 @@
+// SSD1306 over the pico I2C block, updates are fed to the data register by DMA
+
+#include <assert.h>
+#include "ssd1306.h"
+#include "ssd1306_port.h"
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+#include "pico/stdlib.h"
+
+static_assert(SSD1306_TX_STOP == I2C_IC_DATA_CMD_STOP_BITS, "tx stream STOP flag must match IC_DATA_CMD");
+
+static i2c_inst_t *ssd1306_i2c = NULL;
+static unsigned char ssd1306_i2c_address;
+static int ssd1306_dma_chan = -1;
+
+// DMA channel that writes 16 bit entries into the I2C data register, paced by the TX fifo
+void ssd1306_port_init(int i2c_num, unsigned char address) {
+    ssd1306_i2c = i2c_num < 0 ? i2c_default : i2c_get_instance(i2c_num);
+    ssd1306_i2c_address = address;
+    if (ssd1306_dma_chan < 0) {
+        ssd1306_dma_chan = dma_claim_unused_channel(true);
+    }
+    dma_channel_config c = dma_channel_get_default_config(ssd1306_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16); // data byte + STOP bit
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(ssd1306_i2c, true));
+    dma_channel_configure(ssd1306_dma_chan, &c, &i2c_get_hw(ssd1306_i2c)->data_cmd, NULL, 0, false);
+}
+
+void ssd1306_port_command(unsigned char c) {
+    uint8_t buf[2];
+    buf[0] = 0x00; // bit 7 is 0 for Co bit (data bytes only), bit 6 is 0 for DC (data is a command))
+    buf[1] = c;
+    i2c_write_blocking(ssd1306_i2c, ssd1306_i2c_address, buf, 2, false);
+}
+
+void ssd1306_port_send(const uint16_t *tx, int n) {
+    // point the I2C block at the display, the same way i2c_write_blocking does
+    i2c_hw_t *hw = i2c_get_hw(ssd1306_i2c);
+    hw->enable = 0;
+    hw->tar = ssd1306_i2c_address;
+    hw->enable = 1;
+    dma_channel_transfer_from_buffer_now(ssd1306_dma_chan, tx, n);
+}
+
+void ssd1306_port_delay_ms(unsigned int ms) {
+    sleep_ms(ms);
+}
+
+// true while a flush is still going out, don't touch the I2C bus until it is done
+bool ssd1306_busy() {
+    if (ssd1306_dma_chan < 0) {
+        return false;
+    }
+    i2c_hw_t *hw = i2c_get_hw(ssd1306_i2c);
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        // the display didn't ack, the I2C block flushed its fifo so give up on this frame
+        dma_channel_abort(ssd1306_dma_chan);
+        (void) hw->clr_tx_abrt;
+        ssd1306_invalidate(); // don't know how much of it made it, send the whole screen next time
+        return false;
+    }
+    if (dma_channel_is_busy(ssd1306_dma_chan)) {
+        return true;
+    }
+    // DMA is done once the last byte is in the fifo, it still has to go out on the wire
+    return !(hw->status & I2C_IC_STATUS_TFE_BITS) || (hw->status & I2C_IC_STATUS_MST_ACTIVITY_BITS);
+}
+
+// the flush in progress fence, blocks until the last flush has finished
+void ssd1306_wait() {
+    while (ssd1306_busy()) {
+        tight_loop_contents();
+    }
+    if (ssd1306_dma_chan >= 0) {
+        (void) i2c_get_hw(ssd1306_i2c)->clr_stop_det; // the SDK blocking calls watch this flag
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef SSD1306_PORT_H__
+#define SSD1306_PORT_H__
+
+// what ssd1306.c needs from the hardware, ssd1306_pico.c sends it over I2C and
+// ssd1306_host.c plays it into a copy of the display memory. Also provides ssd1306_busy() and ssd1306_wait()
+
+#include <stdint.h>
+
+// the tx stream is one entry per byte, this flag on an entry ends the I2C transaction after it.
+// It is the STOP bit of the RP2040/RP2350 I2C data register so the pico port can DMA the stream as is
+#define SSD1306_TX_STOP 0x200
+
+void ssd1306_port_init(int i2c_num, unsigned char address);
+void ssd1306_port_command(unsigned char c); // blocking, control byte 0x00 then c
+void ssd1306_port_send(const uint16_t *tx, int n); // starts sending and returns, tx must stay put until ssd1306_wait()
+void ssd1306_port_delay_ms(unsigned int ms);
+
+#endif
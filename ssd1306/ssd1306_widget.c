@@ -0,0 +1,115 @@
+// labels and numeric fields for the OLED dashboards, see ssd1306_widget.h
+
+#include <string.h>
+#include "ssd1306.h"
+#include "ssd1306_widget.h"
+
+void ssd1306_label_init(ssd1306_label_t *l, int x, int y, const char *text) {
+    l->x = x;
+    l->y = y;
+    l->shown[0] = '\0';
+    ssd1306_label_set(l, text);
+}
+
+// draw only the cells that changed, returns true if anything was drawn
+bool ssd1306_label_set(ssd1306_label_t *l, const char *text) {
+    bool changed = false;
+    int i;
+    for (i = 0; i < SSD1306_WIDGET_MAX; i++) {
+        char now = l->shown[i];
+        char next = text[i];
+        if (now == '\0' && next == '\0') {
+            break;
+        }
+        if (next == '\0') {
+            // new text is shorter, blank out the tail of the old one
+            int j;
+            for (j = i; l->shown[j] != '\0'; j++) {
+                ssd1306_draw_char(l->x + j*SSD1306_FONT_ADVANCE, l->y, ' ');
+            }
+            changed = true;
+            break;
+        }
+        if (now != next) {
+            ssd1306_draw_char(l->x + i*SSD1306_FONT_ADVANCE, l->y, next);
+            changed = true;
+        }
+        if (now == '\0') {
+            l->shown[i + 1] = '\0'; // keep comparing against an end marker
+        }
+        l->shown[i] = next;
+    }
+    l->shown[i] = '\0';
+    return changed;
+}
+
+// put the whole label back, for after an ssd1306_clear()
+void ssd1306_label_redraw(ssd1306_label_t *l) {
+    ssd1306_draw_string(l->x, l->y, l->shown);
+}
+
+// keeps digits and decimals in range so neither tmp nor the caller's buffer can overflow
+static int clamp_int(int x, int lo, int hi) {
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+int ssd1306_format_fixed(char *buf, int32_t value, int digits, int decimals) {
+    char tmp[SSD1306_FIXED_MAX_DECIMALS + 4]; // 10 digits of an int32 at most, '.', leading '0', '-'
+    int n = 0;
+    digits = clamp_int(digits, 0, SSD1306_WIDGET_MAX);
+    decimals = clamp_int(decimals, 0, SSD1306_FIXED_MAX_DECIMALS);
+    bool negative = value < 0;
+    uint32_t v = negative ? -(uint32_t)value : (uint32_t)value;
+
+    // digits come out backwards, least significant first
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+        if (n == decimals) {
+            tmp[n++] = '.';
+            if (v == 0) {
+                tmp[n++] = '0'; // 0.25 not .25
+            }
+        }
+    } while (v > 0 || n < decimals);
+    if (negative) {
+        tmp[n++] = '-';
+    }
+
+    int len = 0;
+    while (len + n < digits) {
+        buf[len++] = ' ';
+    }
+    while (n > 0) {
+        buf[len++] = tmp[--n];
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+void ssd1306_field_init(ssd1306_field_t *f, int x, int y, const char *label, int digits, int decimals, const char *suffix) {
+    f->x = x;
+    f->y = y;
+    f->label = label;
+    f->suffix = suffix;
+    f->digits = clamp_int(digits, 0, SSD1306_WIDGET_MAX);
+    f->decimals = clamp_int(decimals, 0, SSD1306_FIXED_MAX_DECIMALS);
+    ssd1306_draw_string(x, y, label);
+    ssd1306_label_init(&f->text, x + strlen(label)*SSD1306_FONT_ADVANCE, y, "");
+}
+
+// returns true if the number on screen changed
+bool ssd1306_field_set(ssd1306_field_t *f, int32_t value) {
+    char buf[SSD1306_WIDGET_MAX + 1];
+    int len = ssd1306_format_fixed(buf, value, f->digits, f->decimals);
+    if (f->suffix != NULL) {
+        strncpy(buf + len, f->suffix, SSD1306_WIDGET_MAX - len);
+        buf[SSD1306_WIDGET_MAX] = '\0';
+    }
+    return ssd1306_label_set(&f->text, buf);
+}
+
+void ssd1306_field_redraw(ssd1306_field_t *f) {
+    ssd1306_draw_string(f->x, f->y, f->label);
+    ssd1306_label_redraw(&f->text);
+}
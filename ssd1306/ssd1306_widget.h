@@ -0,0 +1,44 @@
+#ifndef SSD1306_WIDGET_H__
+#define SSD1306_WIDGET_H__
+
+// text that only gets redrawn when it changes. Each widget remembers what it last put on the
+// screen and redraws just the character cells that differ, so a steady value costs nothing on the
+// next ssd1306_update() and a changed digit costs one 5 column window
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SSD1306_WIDGET_MAX 22 // characters, a full 128 pixel row
+#define SSD1306_FIXED_MAX_DECIMALS 10 // an int32 has no more digits to put after the point
+
+// a line of text that can be changed
+typedef struct {
+    int x, y;
+    char shown[SSD1306_WIDGET_MAX + 1]; // what is on the screen now
+} ssd1306_label_t;
+
+// "label" then a fixed point number then "suffix", like "Gain: 0.25" or "PWM L: 60%"
+// the number is an integer scaled by 10^decimals so formatting never touches floats
+typedef struct {
+    int x, y;
+    const char *label;
+    const char *suffix; // may be NULL
+    int digits;   // characters reserved for the number, it is right aligned in them
+    int decimals; // digits after the point
+    ssd1306_label_t text; // number and suffix, placed just after the label
+} ssd1306_field_t;
+
+void ssd1306_label_init(ssd1306_label_t *l, int x, int y, const char *text);
+bool ssd1306_label_set(ssd1306_label_t *l, const char *text);
+void ssd1306_label_redraw(ssd1306_label_t *l);
+
+void ssd1306_field_init(ssd1306_field_t *f, int x, int y, const char *label, int digits, int decimals, const char *suffix);
+bool ssd1306_field_set(ssd1306_field_t *f, int32_t value);
+void ssd1306_field_redraw(ssd1306_field_t *f);
+
+// value/10^decimals right aligned in digits characters, returns the length written. buf needs
+// SSD1306_WIDGET_MAX + 1 chars, digits is capped at SSD1306_WIDGET_MAX and decimals at
+// SSD1306_FIXED_MAX_DECIMALS
+int ssd1306_format_fixed(char *buf, int32_t value, int digits, int decimals);
+
+#endif